@@ -77,19 +77,16 @@ void process_action(keyrecord_t *record)
             {
                 uint8_t mods = (action.kind.id == ACT_LMODS) ?  action.key.mods :
                                                                 action.key.mods<<4;
+                // mods and key are sent in a report
                 if (event.pressed) {
-                    if (mods) {
-                        add_weak_mods(mods);
-                        send_keyboard_report();
-                    }
+                    add_weak_mods(mods);
                     register_code(action.key.code);
                 } else {
+                    del_weak_mods(mods);
                     unregister_code(action.key.code);
-                    if (mods) {
-                        del_weak_mods(mods);
-                        send_keyboard_report();
-                    }
                 }
+                // for mods without key, nothing is sent if no change
+                send_keyboard_report();
             }
             break;
 #ifndef NO_ACTION_TAPPING
@@ -481,6 +478,7 @@ void unregister_mods(uint8_t mods)
 void clear_keyboard(void)
 {
     clear_mods();
+    clear_macro_mods();
     clear_keyboard_but_mods();
 }
 
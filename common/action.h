@@ -52,6 +52,9 @@ action_t action_for_key(uint8_t layer, key_t key);
 /* macro */
 const macro_t *action_get_macro(keyrecord_t *record, uint8_t id, uint8_t opt);
 
+/* sub-macro for CALL command of macro */
+const macro_t *action_get_submacro(uint8_t id);
+
 /* user defined special function */
 void action_function(keyrecord_t *record, uint8_t id, uint8_t opt);
 
@@ -3,6 +3,9 @@
 #include "action.h"
 #include "util.h"
 #include "action_layer.h"
+#ifdef LAYER_CACHE_ENABLE
+#include "matrix.h"
+#endif
 
 #ifdef DEBUG_ACTION
 #include "debug.h"
@@ -11,6 +14,26 @@
 #endif
 
 
+#ifdef LAYER_CACHE_ENABLE
+/*
+ * Action Cache
+ *
+ * Action resolved through layers is kept per key and looked up on next event
+ * instead of searching layers again. All of them are invalidated when layer
+ * state is changed and resolved again lazily.
+ */
+static action_t layer_cache[MATRIX_ROWS][MATRIX_COLS];
+static matrix_row_t layer_cache_valid[MATRIX_ROWS];
+
+void layer_cache_clear(void)
+{
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        layer_cache_valid[i] = 0;
+    }
+}
+#endif
+
+
 /* 
  * Default Layer State
  */
@@ -22,6 +45,9 @@ static void default_layer_state_set(uint32_t state)
     default_layer_debug(); debug(" to ");
     default_layer_state = state;
     default_layer_debug(); debug("\n");
+#ifdef LAYER_CACHE_ENABLE
+    layer_cache_clear();
+#endif
     clear_keyboard_but_mods(); // To avoid stuck keys
 }
 
@@ -63,6 +89,9 @@ static void layer_state_set(uint32_t state)
     layer_debug(); dprint(" to ");
     layer_state = state;
     layer_debug(); dprintln();
+#ifdef LAYER_CACHE_ENABLE
+    layer_cache_clear();
+#endif
     clear_keyboard_but_mods(); // To avoid stuck keys
 }
 
@@ -112,21 +141,21 @@ void layer_debug(void)
 
 
 
-action_t layer_switch_get_action(key_t key)
+static action_t layer_resolve_action(key_t key)
 {
     action_t action;
     action.code = ACTION_TRANSPARENT;
 
 #ifndef NO_ACTION_LAYER
     uint32_t layers = layer_state | default_layer_state;
-    /* check top layer first */
-    for (int8_t i = 31; i >= 0; i--) {
-        if (layers & (1UL<<i)) {
-            action = action_for_key(i, key);
-            if (action.code != ACTION_TRANSPARENT) {
-                return action;
-            }
+    /* check top layer first, only active layers are visited */
+    while (layers) {
+        uint8_t i = biton32(layers);
+        action = action_for_key(i, key);
+        if (action.code != ACTION_TRANSPARENT) {
+            return action;
         }
+        layers &= ~(1UL<<i);
     }
     /* fall back to layer 0 */
     action = action_for_key(0, key);
@@ -136,3 +165,18 @@ action_t layer_switch_get_action(key_t key)
     return action;
 #endif
 }
+
+action_t layer_switch_get_action(key_t key)
+{
+#ifdef LAYER_CACHE_ENABLE
+    if (key.row < MATRIX_ROWS && key.col < MATRIX_COLS) {
+        matrix_row_t col_bit = (matrix_row_t)1<<key.col;
+        if (!(layer_cache_valid[key.row] & col_bit)) {
+            layer_cache[key.row][key.col] = layer_resolve_action(key);
+            layer_cache_valid[key.row] |= col_bit;
+        }
+        return layer_cache[key.row][key.col];
+    }
+#endif
+    return layer_resolve_action(key);
+}
@@ -14,10 +14,12 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
-#include <util/delay.h>
 #include "action.h"
 #include "action_util.h"
 #include "action_macro.h"
+#include "host.h"
+#include "timer.h"
+#include "deadline.h"
 
 #ifdef DEBUG_ACTION
 #include "debug.h"
@@ -28,20 +30,169 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #ifndef NO_ACTION_MACRO
 
-#define MACRO_READ()  (macro = pgm_read_byte(macro_p++))
+/* macro or sub-macro being played */
+typedef struct {
+    const macro_t *pc;      // next command
+    const macro_t *loop;    // start of REPEAT
+    uint8_t count;          // times left to play REPEAT
+    uint8_t keys;           // keys left to type of KEYS
+    uint8_t last;           // last key typed of KEYS
+} macro_frame_t;
+
+/* playback state of a macro */
+typedef struct {
+    macro_frame_t frame[2]; // macro and sub-macro
+    uint8_t depth;          // 0: idle, 1: macro, 2: sub-macro
+    uint16_t time;          // when wait started
+    uint16_t wait;          // milli-seconds to wait before next command
+    uint8_t interval;       // milli-seconds to wait after each command
+    uint8_t mods;           // modifiers of macro, not of user's keys
+} macro_player_t;
+
+static macro_player_t players[MACRO_PLAYER_NUM];
+
+static void macro_player_run(macro_player_t *player);
+static void macro_player_play(macro_player_t *player);
+static void macro_type_key(macro_frame_t *frame);
+static void macro_deadline_update(void);
+
+
+/* start macro, commands are played till it waits and rest is played by action_macro_task() */
 void action_macro_play(const macro_t *macro_p)
+{
+    if (!macro_p) return;
+    if (!action_macro_verify(macro_p)) {
+        dprint("action_macro_play: invalid macro\n");
+        return;
+    }
+    for (uint8_t i = 0; i < MACRO_PLAYER_NUM; i++) {
+        if (!players[i].depth) {
+            players[i] = (macro_player_t){ .frame[0].pc = macro_p, .depth = 1 };
+            macro_player_run(&players[i]);
+            macro_deadline_update();
+            return;
+        }
+    }
+    dprint("action_macro_play: no player available, dropped\n");
+}
+
+void action_macro_task(void)
+{
+    for (uint8_t i = 0; i < MACRO_PLAYER_NUM; i++) {
+        if (players[i].depth && TIMER_DIFF_16(timer_read(), players[i].time) >= players[i].wait) {
+            macro_player_run(&players[i]);
+        }
+    }
+    macro_deadline_update();
+}
+
+bool action_macro_playing(void)
+{
+    for (uint8_t i = 0; i < MACRO_PLAYER_NUM; i++) {
+        if (players[i].depth) return true;
+    }
+    return false;
+}
+
+/* action_macro_task() is called at end of the earliest wait */
+static void macro_deadline_update(void)
+{
+    uint16_t now = timer_read();
+    uint16_t next = UINT16_MAX;
+    for (uint8_t i = 0; i < MACRO_PLAYER_NUM; i++) {
+        if (!players[i].depth) continue;
+        uint16_t elapsed = TIMER_DIFF_16(now, players[i].time);
+        uint16_t left = (elapsed < players[i].wait) ? players[i].wait - elapsed : 0;
+        if (left < next) next = left;
+    }
+    if (next == UINT16_MAX) {
+        deadline_clear(DEADLINE_MACRO);
+    } else {
+        deadline_set(DEADLINE_MACRO, now + next);
+    }
+}
+
+/* check operands, REPEAT/LOOP pairs and END of macro */
+bool action_macro_verify(const macro_t *macro_p)
+{
+    bool repeat = false;
+    macro_t macro;
+
+    while (true) {
+        switch (pgm_read_byte(macro_p++)) {
+            case END:
+                return !repeat;
+            case KEY_DOWN:
+            case KEY_UP:
+            case MODS:
+            case WAIT:
+            case INTERVAL:
+            case CALL:
+                macro_p += 1;
+                break;
+            case SYSTEM:
+            case CONSUMER:
+                macro_p += 2;
+                break;
+            case REPEAT:
+                if (repeat || !pgm_read_byte(macro_p++)) return false;
+                repeat = true;
+                break;
+            case LOOP:
+                if (!repeat) return false;
+                repeat = false;
+                break;
+            case KEYS:
+                macro = pgm_read_byte(macro_p++);
+                if (!macro) return false;
+                for (uint8_t n = macro; n; n--) {
+                    macro = pgm_read_byte(macro_p++);
+                    if (!IS_KEY(macro)) return false;
+                }
+                break;
+            case 0x04 ... 0x73:
+            case 0x84 ... 0xF3:
+                break;
+            default:
+                return false;
+        }
+    }
+}
+
+/* play with modifiers of the player, reports of user's keys don't have them
+ * while it plays */
+static void macro_player_run(macro_player_t *player)
+{
+    set_macro_play_mods(player->mods);
+    macro_player_play(player);
+    set_macro_play_mods(0);
+}
+
+#define MACRO_READ()  (macro = pgm_read_byte(frame->pc++))
+static void macro_player_play(macro_player_t *player)
 {
     macro_t macro = END;
-    uint8_t interval = 0;
+    uint16_t wait;
 
-    if (!macro_p) return;
     while (true) {
-        switch (MACRO_READ()) {
+        macro_frame_t *frame = &player->frame[player->depth - 1];
+        // wait for host driver to take reports
+        if (!host_keyboard_ready()) {
+            player->time = timer_read();
+            player->wait = 1;
+            return;
+        }
+        wait = 0;
+        if (frame->keys) {
+            macro_type_key(frame);
+        } else switch (MACRO_READ()) {
             case KEY_DOWN:
                 MACRO_READ();
                 dprintf("KEY_DOWN(%02X)\n", macro);
                 if (IS_MOD(macro)) {
-                    add_weak_mods(MOD_BIT(macro));
+                    player->mods |= MOD_BIT(macro);
+                    set_macro_play_mods(player->mods);
+                    send_keyboard_report();
                 } else {
                     register_code(macro);
                 }
@@ -50,19 +201,75 @@ void action_macro_play(const macro_t *macro_p)
                 MACRO_READ();
                 dprintf("KEY_UP(%02X)\n", macro);
                 if (IS_MOD(macro)) {
-                    del_weak_mods(MOD_BIT(macro));
+                    // also releases one left down by a macro ended
+                    player->mods &= ~MOD_BIT(macro);
+                    set_macro_mods(get_macro_mods() & ~MOD_BIT(macro));
+                    set_macro_play_mods(player->mods);
+                    send_keyboard_report();
                 } else {
                     unregister_code(macro);
                 }
                 break;
+            case MODS:
+                MACRO_READ();
+                dprintf("MODS(%02X)\n", macro);
+                player->mods = macro;
+                clear_macro_mods();
+                set_macro_play_mods(player->mods);
+                send_keyboard_report();
+                break;
             case WAIT:
                 MACRO_READ();
                 dprintf("WAIT(%u)\n", macro);
-                { uint8_t ms = macro; while (ms--) _delay_ms(1); }
+                wait = macro;
                 break;
             case INTERVAL:
-                interval = MACRO_READ();
-                dprintf("INTERVAL(%u)\n", interval);
+                player->interval = MACRO_READ();
+                dprintf("INTERVAL(%u)\n", player->interval);
+                break;
+            case SYSTEM:
+            case CONSUMER:
+                {
+                    uint8_t command = macro;
+                    uint16_t usage = MACRO_READ();
+                    usage |= MACRO_READ()<<8;
+                    if (command == SYSTEM) {
+                        dprintf("SYSTEM(%04X)\n", usage);
+                        host_system_send(usage);
+                    } else {
+                        dprintf("CONSUMER(%04X)\n", usage);
+                        host_consumer_send(usage);
+                    }
+                }
+                break;
+            case REPEAT:
+                frame->count = MACRO_READ();
+                frame->loop = frame->pc;
+                dprintf("REPEAT(%u)\n", frame->count);
+                break;
+            case LOOP:
+                if (--frame->count) frame->pc = frame->loop;
+                break;
+            case CALL:
+                MACRO_READ();
+                dprintf("CALL(%u)\n", macro);
+                if (player->depth < 2) {
+                    const macro_t *sub = action_get_submacro(macro);
+                    if (sub && action_macro_verify(sub)) {
+                        player->frame[1] = (macro_frame_t){ .pc = sub };
+                        player->depth = 2;
+                    } else {
+                        dprint("CALL: invalid sub-macro\n");
+                    }
+                } else {
+                    dprint("CALL: nested\n");
+                }
+                break;
+            case KEYS:
+                frame->keys = MACRO_READ();
+                frame->last = 0;
+                dprintf("KEYS(%u)\n", frame->keys);
+                macro_type_key(frame);
                 break;
             case 0x04 ... 0x73:
                 dprintf("DOWN(%02X)\n", macro);
@@ -74,10 +281,44 @@ void action_macro_play(const macro_t *macro_p)
                 break;
             case END:
             default:
-                return;
+                // return from sub-macro or stop
+                player->depth--;
+                if (!player->depth) {
+                    // modifiers left down stay in reports till a macro releases them
+                    set_macro_mods(get_macro_mods() | player->mods);
+                    player->mods = 0;
+                    set_macro_play_mods(0);
+                    return;
+                }
+                break;
         }
         // interval
-        { uint8_t ms = interval; while (ms--) _delay_ms(1); }
+        wait += player->interval;
+        if (wait) {
+            player->time = timer_read();
+            player->wait = wait;
+            return;
+        }
+    }
+}
+
+/* press next key and release last key in a report */
+static void macro_type_key(macro_frame_t *frame)
+{
+    macro_t macro;
+
+    MACRO_READ();
+    if (frame->last) {
+        del_key(frame->last);
+        // same key needs release in between
+        if (macro == frame->last) send_keyboard_report();
+    }
+    add_key(macro);
+    send_keyboard_report();
+    frame->last = macro;
+    if (!--frame->keys) {
+        del_key(macro);
+        send_keyboard_report();
     }
 }
 #endif
@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef ACTION_MACRO_H
 #define ACTION_MACRO_H
 #include <stdint.h>
+#include <stdbool.h>
 #include <avr/pgmspace.h>
 
 
@@ -27,10 +28,21 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 typedef uint8_t macro_t;
 
 
+/* number of macros played at the same time */
+#ifndef MACRO_PLAYER_NUM
+#define MACRO_PLAYER_NUM    2
+#endif
+
+
 #ifndef NO_ACTION_MACRO
 void action_macro_play(const macro_t *macro_p);
+void action_macro_task(void);
+bool action_macro_playing(void);
+bool action_macro_verify(const macro_t *macro_p);
 #else
 #define action_macro_play(macro)
+#define action_macro_task()
+#define action_macro_playing()  false
 #endif
 
 
@@ -40,30 +52,49 @@ void action_macro_play(const macro_t *macro_p);
  *   code(0x04-73) | 0x80               // key up(1byte)
  *   { KEY_DOWN, code(0x04-0xff) }      // key down(2bytes)
  *   { KEY_UP,   code(0x04-0xff) }      // key up(2bytes)
+ *   { MODS, mods }                     // set modifiers(2bytes)
  *   WAIT                               // wait milli-seconds
  *   INTERVAL                           // set interval between macro commands
+ *   { SYSTEM, usage(lo), usage(hi) }   // send system usage(3bytes)
+ *   { CONSUMER, usage(lo), usage(hi) } // send consumer usage(3bytes)
+ *   { REPEAT, count(1-255) }           // repeat commands till LOOP(2bytes)
+ *   LOOP                               // end of REPEAT
+ *   { CALL, id }                       // play sub-macro(2bytes)
+ *   { KEYS, n, code(0x04-0xa4) * n }   // type keys with rollover(2+n bytes)
  *   END                                // stop macro execution
  *
+ * WAIT and INTERVAL don't block, rest of macro is played by action_macro_task().
+ * REPEAT can't be nested in a macro, and CALL can't be used in sub-macro.
+ * KEYS presses next key and releases last key in a report, INTERVAL applies
+ * to each key. Macro waits while host_keyboard_ready() is false.
+ * Modifiers of KEY_DOWN/KEY_UP/MODS are sent with a report at each change.
+ * While macro plays they are only in reports sent by the macro, keys typed
+ * while it waits don't get them. Modifiers left down at END stay in every
+ * report till KEY_UP or MODS of a macro releases them, as register_code()
+ * did, so that a macro can hold Alt for another to type Tab with.
+ *
  * Ideas(Not implemented):
- *   modifiers
- *   system usage
- *   consumer usage
  *   unicode usage
- *   function call
  *   conditionals
- *   loop
  */
 enum macro_command_id{
     /* 0x00 - 0x03 */
     END                 = 0x00,
     KEY_DOWN,
     KEY_UP,
+    MODS,
 
     /* 0x04 - 0x73 (reserved for keycode down) */
 
     /* 0x74 - 0x83 */
     WAIT                = 0x74,
     INTERVAL,
+    SYSTEM,
+    CONSUMER,
+    REPEAT,
+    LOOP,
+    CALL,
+    KEYS,
 
     /* 0x84 - 0xf3 (reserved for keycode up) */
 
@@ -82,6 +113,12 @@ enum macro_command_id{
 #define TYPE(key)       DOWN(key), UP(key)
 #define WAIT(ms)        WAIT, (ms)
 #define INTERVAL(ms)    INTERVAL, (ms)
+#define MODS(mods)      MODS, (mods)
+#define SYSTEM(usage)   SYSTEM, ((usage) & 0xFF), ((usage) >> 8)
+#define CONSUMER(usage) CONSUMER, ((usage) & 0xFF), ((usage) >> 8)
+#define REPEAT(count)   REPEAT, (count)
+#define CALL(id)        CALL, (id)
+#define KEYS(...)       KEYS, sizeof((uint8_t[]){ __VA_ARGS__ }), __VA_ARGS__
 
 /* key down */
 #define D(key)          DOWN(KC_##key)
@@ -1,10 +1,12 @@
 #include <stdint.h>
 #include <stdbool.h>
+#include <avr/pgmspace.h>
 #include "action.h"
 #include "action_layer.h"
 #include "action_tapping.h"
 #include "keycode.h"
 #include "timer.h"
+#include "deadline.h"
 
 #ifdef DEBUG_ACTION
 #include "debug.h"
@@ -18,24 +20,61 @@
 #define IS_TAPPING_PRESSED()    (IS_TAPPING() && tapping_key.event.pressed)
 #define IS_TAPPING_RELEASED()   (IS_TAPPING() && !tapping_key.event.pressed)
 #define IS_TAPPING_KEY(k)       (IS_TAPPING() && KEYEQ(tapping_key.event.key, (k)))
-#define WITHIN_TAPPING_TERM(e)  (TIMER_DIFF_16(e.time, tapping_key.event.time) < TAPPING_TERM)
+#ifdef KEYEVENT_TIME_US
+#define WITHIN_TAPPING_TERM(e)  ((e.time_us - tapping_key.event.time_us) < (uint32_t)tapping_term * 1000)
+#else
+#define WITHIN_TAPPING_TERM(e)  (TIMER_DIFF_16(e.time, tapping_key.event.time) < tapping_term)
+#endif
+
+#if (WAITING_BUFFER_SIZE & (WAITING_BUFFER_SIZE - 1)) || WAITING_BUFFER_SIZE > 128
+#   error "WAITING_BUFFER_SIZE must be power of two up to 128"
+#endif
+#define WAITING_BUFFER_MASK     (WAITING_BUFFER_SIZE - 1)
+#define WAITING_BUFFER_NEXT(i)  (((i) + 1) & WAITING_BUFFER_MASK)
 
 
 static keyrecord_t tapping_key = {};
+static uint16_t tapping_term = TAPPING_TERM;
 static keyrecord_t waiting_buffer[WAITING_BUFFER_SIZE] = {};
 static uint8_t waiting_buffer_head = 0;
 static uint8_t waiting_buffer_tail = 0;
+static uint8_t waiting_buffer_max = 0;
+static uint16_t overflow_settled = 0;
 
 static bool process_tapping(keyrecord_t *record);
 static bool waiting_buffer_enq(keyrecord_t record);
 static void waiting_buffer_clear(void);
 static bool waiting_buffer_typed(keyevent_t event);
-static bool waiting_buffer_has_anykey_pressed(void);
+static void waiting_buffer_process(void);
 static void waiting_buffer_scan_tap(void);
 static void debug_tapping_key(void);
 static void debug_waiting_buffer(void);
 
 
+/* period of tapping per kind of action */
+static const uint16_t tapping_term_kind[16] PROGMEM = {
+    [ACT_LMODS_TAP]     = TAPPING_TERM_MODS_TAP,
+    [ACT_RMODS_TAP]     = TAPPING_TERM_MODS_TAP,
+    [ACT_LAYER_TAP]     = TAPPING_TERM_LAYER_TAP,
+    [ACT_LAYER_TAP_EXT] = TAPPING_TERM_LAYER_TAP,
+    [ACT_MACRO]         = TAPPING_TERM,
+    [ACT_FUNCTION]      = TAPPING_TERM,
+};
+
+__attribute__ ((weak))
+uint16_t action_get_tapping_term(keyrecord_t *record, action_t action)
+{
+    uint16_t term = pgm_read_word(&tapping_term_kind[action.kind.id]);
+    return (term ? term : TAPPING_TERM);
+}
+
+/* settle period when tapping of a key starts */
+static void tapping_term_set(keyrecord_t *keyp)
+{
+    tapping_term = action_get_tapping_term(keyp, layer_switch_get_action(keyp->event.key));
+}
+
+
 void action_tapping_process(keyrecord_t record)
 {
     if (process_tapping(&record)) {
@@ -44,11 +83,22 @@ void action_tapping_process(keyrecord_t record)
         }
     } else {
         if (!waiting_buffer_enq(record)) {
-            // clear all in case of overflow.
-            debug("OVERFLOW: CLEAR ALL STATES\n");
-            clear_keyboard();
-            waiting_buffer_clear();
-            tapping_key = (keyrecord_t){};
+            if (IS_TAPPING_PRESSED() && tapping_key.tap.count == 0) {
+                // settle tapping as hold and process events waiting for it
+                debug("OVERFLOW: SETTLE TAPPING AS HOLD\n");
+                overflow_settled++;
+                process_action(&tapping_key);
+                tapping_key = (keyrecord_t){};
+                debug_tapping_key();
+                waiting_buffer_process();
+            }
+            if (!waiting_buffer_enq(record)) {
+                // clear all in case of overflow.
+                debug("OVERFLOW: CLEAR ALL STATES\n");
+                clear_keyboard();
+                waiting_buffer_clear();
+                tapping_key = (keyrecord_t){};
+            }
         }
     }
 
@@ -56,17 +106,30 @@ void action_tapping_process(keyrecord_t record)
     if (!IS_NOEVENT(record.event) && waiting_buffer_head != waiting_buffer_tail) {
         debug("---- action_exec: process waiting_buffer -----\n");
     }
-    for (; waiting_buffer_tail != waiting_buffer_head; waiting_buffer_tail = (waiting_buffer_tail + 1) % WAITING_BUFFER_SIZE) {
-        if (process_tapping(&waiting_buffer[waiting_buffer_tail])) {
-            debug("processed: waiting_buffer["); debug_dec(waiting_buffer_tail); debug("] = ");
-            debug_record(waiting_buffer[waiting_buffer_tail]); debug("\n\n");
-        } else {
-            break;
-        }
-    }
+    waiting_buffer_process();
     if (!IS_NOEVENT(record.event)) {
         debug("\n");
     }
+
+    // pseudo tick event settles tap key at end of its term, which can come
+    // 1ms early as event time is odd. Deadline is set again till it settles.
+    if (IS_TAPPING()) {
+        deadline_set(DEADLINE_TAPPING, tapping_key.event.time + tapping_term - 1);
+    } else if (waiting_buffer_head != waiting_buffer_tail) {
+        deadline_set(DEADLINE_TAPPING, timer_read());
+    } else {
+        deadline_clear(DEADLINE_TAPPING);
+    }
+}
+
+uint8_t waiting_buffer_peak(void)
+{
+    return waiting_buffer_max;
+}
+
+uint16_t waiting_buffer_overflow_settled(void)
+{
+    return overflow_settled;
 }
 
 
@@ -96,7 +159,7 @@ bool process_tapping(keyrecord_t *keyp)
                     // enqueue
                     return false;
                 }
-#if TAPPING_TERM >= 500
+#if TAPPING_TERM >= 500 || defined(TAPPING_PERMISSIVE_HOLD)
                 /* Process a key typed within TAPPING_TERM
                  * This can register the key before settlement of tapping,
                  * useful for long TAPPING_TERM but may prevent fast typing.
@@ -134,6 +197,20 @@ bool process_tapping(keyrecord_t *keyp)
                     process_action(keyp);
                     return true;
                 }
+#ifdef TAPPING_HOLD_ON_OTHER_KEY_PRESS
+                /* Settle as hold when other key is pressed
+                 * This registers the key without waiting for TAPPING_TERM,
+                 * but rolling over with tap key can't be a tap.
+                 */
+                else if (IS_PRESSED(event)) {
+                    debug("Tapping: End. No tap. Interfered by pressed key\n");
+                    process_action(&tapping_key);
+                    tapping_key = (keyrecord_t){};
+                    debug_tapping_key();
+                    // enqueue
+                    return false;
+                }
+#endif
                 else {
                     // set interrupted flag when other key preesed during tapping
                     if (event.pressed) {
@@ -167,6 +244,7 @@ bool process_tapping(keyrecord_t *keyp)
                         debug("Tapping: Start while last tap(1).\n");
                     }
                     tapping_key = *keyp;
+                    tapping_term_set(keyp);
                     waiting_buffer_scan_tap();
                     debug_tapping_key();
                     return true;
@@ -211,6 +289,7 @@ bool process_tapping(keyrecord_t *keyp)
                         debug("Tapping: Start while last timeout tap(1).\n");
                     }
                     tapping_key = *keyp;
+                    tapping_term_set(keyp);
                     waiting_buffer_scan_tap();
                     debug_tapping_key();
                     return true;
@@ -240,12 +319,14 @@ bool process_tapping(keyrecord_t *keyp)
                     } else {
                         // FIX: start new tap again
                         tapping_key = *keyp;
+                        tapping_term_set(keyp);
                         return true;
                     }
                 } else if (is_tap_key(event.key)) {
                     // Sequential tap can be interfered with other tap key.
                     debug("Tapping: Start with interfering other tap.\n");
                     tapping_key = *keyp;
+                    tapping_term_set(keyp);
                     waiting_buffer_scan_tap();
                     debug_tapping_key();
                     return true;
@@ -276,6 +357,7 @@ bool process_tapping(keyrecord_t *keyp)
         if (event.pressed && is_tap_key(event.key)) {
             debug("Tapping: Start(Press tap key).\n");
             tapping_key = *keyp;
+            tapping_term_set(keyp);
             waiting_buffer_scan_tap();
             debug_tapping_key();
             return true;
@@ -296,18 +378,34 @@ bool waiting_buffer_enq(keyrecord_t record)
         return true;
     }
 
-    if ((waiting_buffer_head + 1) % WAITING_BUFFER_SIZE == waiting_buffer_tail) {
+    if (WAITING_BUFFER_NEXT(waiting_buffer_head) == waiting_buffer_tail) {
         debug("waiting_buffer_enq: Over flow.\n");
         return false;
     }
 
     waiting_buffer[waiting_buffer_head] = record;
-    waiting_buffer_head = (waiting_buffer_head + 1) % WAITING_BUFFER_SIZE;
+    waiting_buffer_head = WAITING_BUFFER_NEXT(waiting_buffer_head);
+
+    uint8_t used = (waiting_buffer_head - waiting_buffer_tail) & WAITING_BUFFER_MASK;
+    if (used > waiting_buffer_max) waiting_buffer_max = used;
 
     debug("waiting_buffer_enq: "); debug_waiting_buffer();
     return true;
 }
 
+/* process events in order until one waits for tapping */
+void waiting_buffer_process(void)
+{
+    for (; waiting_buffer_tail != waiting_buffer_head; waiting_buffer_tail = WAITING_BUFFER_NEXT(waiting_buffer_tail)) {
+        if (process_tapping(&waiting_buffer[waiting_buffer_tail])) {
+            debug("processed: waiting_buffer["); debug_dec(waiting_buffer_tail); debug("] = ");
+            debug_record(waiting_buffer[waiting_buffer_tail]); debug("\n\n");
+        } else {
+            break;
+        }
+    }
+}
+
 void waiting_buffer_clear(void)
 {
     waiting_buffer_head = 0;
@@ -316,7 +414,7 @@ void waiting_buffer_clear(void)
 
 bool waiting_buffer_typed(keyevent_t event)
 {
-    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
+    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = WAITING_BUFFER_NEXT(i)) {
         if (KEYEQ(event.key, waiting_buffer[i].event.key) && event.pressed !=  waiting_buffer[i].event.pressed) {
             return true;
         }
@@ -324,14 +422,6 @@ bool waiting_buffer_typed(keyevent_t event)
     return false;
 }
 
-bool waiting_buffer_has_anykey_pressed(void)
-{
-    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
-        if (waiting_buffer[i].event.pressed) return true;
-    }
-    return false;
-}
-
 /* scan buffer for tapping */
 void waiting_buffer_scan_tap(void)
 {
@@ -340,7 +430,7 @@ void waiting_buffer_scan_tap(void)
     // invalid state: tapping_key released && tap.count == 0
     if (!tapping_key.event.pressed) return;
 
-    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
+    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = WAITING_BUFFER_NEXT(i)) {
         if (IS_TAPPING_KEY(waiting_buffer[i].event.key) &&
                 !waiting_buffer[i].event.pressed &&
                 WITHIN_TAPPING_TERM(waiting_buffer[i].event)) {
@@ -367,7 +457,7 @@ static void debug_tapping_key(void)
 static void debug_waiting_buffer(void)
 {
     debug("{ ");
-    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
+    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = WAITING_BUFFER_NEXT(i)) {
         debug("["); debug_dec(i); debug("]="); debug_record(waiting_buffer[i]); debug(" ");
     }
     debug("}\n");
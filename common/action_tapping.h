@@ -24,16 +24,34 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define TAPPING_TERM    200
 #endif
 
+/* period of tapping(ms) per kind of action */
+#ifndef TAPPING_TERM_MODS_TAP
+#define TAPPING_TERM_MODS_TAP   TAPPING_TERM
+#endif
+#ifndef TAPPING_TERM_LAYER_TAP
+#define TAPPING_TERM_LAYER_TAP  TAPPING_TERM
+#endif
+
 /* tap count needed for toggling a feature */
 #ifndef TAPPING_TOGGLE
 #define TAPPING_TOGGLE  5
 #endif
 
+/* events queued while tapping is unsettled, power of two up to 128 */
+#ifndef WAITING_BUFFER_SIZE
 #define WAITING_BUFFER_SIZE 8
+#endif
 
 
 #ifndef NO_ACTION_TAPPING
 void action_tapping_process(keyrecord_t record);
+
+/* period of tapping(ms) for the tap key. override this to set it per key. */
+uint16_t action_get_tapping_term(keyrecord_t *record, action_t action);
+
+/* peak occupancy of waiting buffer and count of tap keys settled on its overflow */
+uint8_t waiting_buffer_peak(void);
+uint16_t waiting_buffer_overflow_settled(void);
 #endif
 
 #endif
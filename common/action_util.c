@@ -14,21 +14,45 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <string.h>
 #include "host.h"
 #include "report.h"
 #include "debug.h"
+#include "util.h"
 #include "action_util.h"
 #include "timer.h"
 
-static inline void add_key_byte(uint8_t code);
-static inline void del_key_byte(uint8_t code);
-#ifdef NKRO_ENABLE
-static inline void add_key_bit(uint8_t code);
-static inline void del_key_bit(uint8_t code);
-#endif
+static inline void report_keys_fill(void);
+
+static void report_send(report_keyboard_t *report);
 
 static uint8_t real_mods = 0;
 static uint8_t weak_mods = 0;
+static uint8_t macro_mods = 0;
+static uint8_t macro_play_mods = 0;
+
+/* Pressed keys
+ *
+ * Bitmap of keycodes is the state of keys and NKRO report is made from it.
+ * 6KRO report is made from slots which are assigned to keys on press,
+ * used slots are marked in bit mask. Key over slots is only in bitmap.
+ * Both are kept regardless of keyboard_nkro, so that protocol can be
+ * switched while keys are held.
+ */
+#if REPORT_KEYS <= 8
+typedef uint8_t key_slot_mask_t;
+#   define key_slot_biton(bits) biton(bits)
+#elif REPORT_KEYS <= 16
+typedef uint16_t key_slot_mask_t;
+#   define key_slot_biton(bits) biton16(bits)
+#else
+typedef uint32_t key_slot_mask_t;
+#   define key_slot_biton(bits) biton32(bits)
+#endif
+static uint8_t key_bits[32] = {};
+static uint8_t key_count = 0;
+static uint8_t key_slots[REPORT_KEYS] = {};
+static key_slot_mask_t key_slot_used = 0;
 
 
 // TODO: pointer variable is not needed
@@ -42,10 +66,27 @@ static int16_t oneshot_time = 0;
 #endif
 #endif
 
+/* last report sent to host */
+static report_keyboard_t report_sent = {};
+#ifdef NKRO_ENABLE
+static bool report_sent_nkro = false;
+#endif
+
+#ifdef BATCH_SCAN_ENABLE
+static bool batch = false;
+static bool batch_pending = false;
+static report_keyboard_t batch_report = {};
+
+#endif
+static bool report_has_key(report_keyboard_t *report, uint8_t code);
+
 
 void send_keyboard_report(void) {
+    report_keys_fill();
     keyboard_report->mods  = real_mods;
     keyboard_report->mods |= weak_mods;
+    keyboard_report->mods |= macro_mods;
+    keyboard_report->mods |= macro_play_mods;
 #ifndef NO_ACTION_ONESHOT
     if (oneshot_mods) {
 #if (defined(ONESHOT_TIMEOUT) && (ONESHOT_TIMEOUT > 0))
@@ -60,38 +101,133 @@ void send_keyboard_report(void) {
         }
     }
 #endif
-    host_keyboard_send(keyboard_report);
+#ifdef BATCH_SCAN_ENABLE
+    if (batch) {
+        // flush pending report before a change on it would be overwritten unsent
+        if (batch_pending && keyboard_report_edge_lost(&report_sent, &batch_report, keyboard_report)) {
+            report_send(&batch_report);
+        }
+        batch_report = *keyboard_report;
+        batch_pending = true;
+        return;
+    }
+#endif
+    report_send(keyboard_report);
 }
 
-/* key */
-void add_key(uint8_t key)
+/* send report only when it differs from last one */
+static void report_send(report_keyboard_t *report)
 {
 #ifdef NKRO_ENABLE
-    if (keyboard_nkro) {
-        add_key_bit(key);
+    if (report_sent_nkro != keyboard_nkro) {
+        // keys held on old interface are released there before sent on the
+        // other, even if its bytes are same
+        report_keyboard_t empty = {};
+        if (memcmp(&report_sent, &empty, sizeof(report_keyboard_t))) {
+            bool nkro = keyboard_nkro;
+            keyboard_nkro = report_sent_nkro;
+            report_sent = empty;
+            host_keyboard_send(&report_sent);
+            keyboard_nkro = nkro;
+        }
+        report_sent_nkro = keyboard_nkro;
+    } else if (!memcmp(report, &report_sent, sizeof(report_keyboard_t))) {
         return;
     }
+#else
+    if (!memcmp(report, &report_sent, sizeof(report_keyboard_t))) return;
 #endif
-    add_key_byte(key);
+    report_sent = *report;
+    host_keyboard_send(report);
 }
 
-void del_key(uint8_t key)
-{
 #ifdef NKRO_ENABLE
-    if (keyboard_nkro) {
-        del_key_bit(key);
+/* Protocol switch
+ * Keys held are sent on switched interface at once even if nothing changes,
+ * report_send() releases them on old one before. Any report sent after the
+ * switch does the same, even before this is called.
+ */
+void keyboard_report_switch(void)
+{
+    if (report_sent_nkro == keyboard_nkro) return;
+
+    report_keyboard_t empty = {};
+    if (!memcmp(&report_sent, &empty, sizeof(report_keyboard_t))) {
+        // nothing held on old interface
+        report_sent_nkro = keyboard_nkro;
         return;
     }
+    send_keyboard_report();
+}
+#endif
+
+#ifdef BATCH_SCAN_ENABLE
+/* Batch of report
+ *
+ * Reports are deferred between begin and end, then only the last one is sent.
+ * Intermediate report is still sent when a key or modifier in it would be
+ * changed back before sent, so that host doesn't miss press and release.
+ */
+void keyboard_report_batch_begin(void)
+{
+    batch = true;
+    batch_pending = false;
+}
+
+void keyboard_report_batch_end(void)
+{
+    batch = false;
+    if (batch_pending) {
+        batch_pending = false;
+        report_send(&batch_report);
+    }
+}
 #endif
-    del_key_byte(key);
+
+/* key */
+void add_key(uint8_t key)
+{
+    uint8_t bit = 1<<(key&7);
+    if (key_bits[key>>3] & bit) return;
+    key_bits[key>>3] |= bit;
+    key_count++;
+
+    key_slot_mask_t free = ~key_slot_used & (((key_slot_mask_t)1<<(REPORT_KEYS-1)<<1) - 1);
+    if (free) {
+        // lowest free slot
+        uint8_t i = key_slot_biton(free & -free);
+        key_slots[i] = key;
+        key_slot_used |= (key_slot_mask_t)1<<i;
+    }
+}
+
+void del_key(uint8_t key)
+{
+    uint8_t bit = 1<<(key&7);
+    if (!(key_bits[key>>3] & bit)) return;
+    key_bits[key>>3] &= ~bit;
+    key_count--;
+
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+        if (key_slots[i] == key) {
+            key_slots[i] = 0;
+            key_slot_used &= ~((key_slot_mask_t)1<<i);
+            break;
+        }
+    }
 }
 
 void clear_keys(void)
 {
     // not clear mods
-    for (int8_t i = 1; i < REPORT_SIZE; i++) {
-        keyboard_report->raw[i] = 0;
+    for (uint8_t i = 0; i < sizeof(key_bits); i++) {
+        key_bits[i] = 0;
     }
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+        key_slots[i] = 0;
+    }
+    key_count = 0;
+    key_slot_used = 0;
 }
 
 
@@ -109,6 +245,16 @@ void del_weak_mods(uint8_t mods) { weak_mods &= ~mods; }
 void set_weak_mods(uint8_t mods) { weak_mods = mods; }
 void clear_weak_mods(void) { weak_mods = 0; }
 
+/* Macro modifier
+ * macro_mods are left down by macros after their end and are in every
+ * report like register_code(), macro_play_mods are of macro being played and
+ * only in reports it sends.
+ */
+uint8_t get_macro_mods(void) { return macro_mods; }
+void set_macro_mods(uint8_t mods) { macro_mods = mods; }
+void clear_macro_mods(void) { macro_mods = 0; }
+void set_macro_play_mods(uint8_t mods) { macro_play_mods = mods; }
+
 /* Oneshot modifier */
 #ifndef NO_ACTION_ONESHOT
 void set_oneshot_mods(uint8_t mods)
@@ -135,12 +281,7 @@ void clear_oneshot_mods(void)
  */
 uint8_t has_anykey(void)
 {
-    uint8_t cnt = 0;
-    for (uint8_t i = 1; i < REPORT_SIZE; i++) {
-        if (keyboard_report->raw[i])
-            cnt++;
-    }
-    return cnt;
+    return key_count;
 }
 
 uint8_t has_anymod(void)
@@ -153,61 +294,64 @@ uint8_t get_first_key(void)
 #ifdef NKRO_ENABLE
     if (keyboard_nkro) {
         uint8_t i = 0;
-        for (; i < REPORT_BITS && !keyboard_report->nkro.bits[i]; i++)
+        for (; i < REPORT_BITS && !key_bits[i]; i++)
             ;
-        return i<<3 | biton(keyboard_report->nkro.bits[i]);
+        return i<<3 | biton(key_bits[i]);
     }
 #endif
-    return keyboard_report->keys[0];
+    return key_slots[0];
 }
 
 
 
 /* local functions */
-static inline void add_key_byte(uint8_t code)
+/* make keys of report from bitmap or slots */
+static inline void report_keys_fill(void)
 {
-    int8_t i = 0;
-    int8_t empty = -1;
-    for (; i < REPORT_KEYS; i++) {
-        if (keyboard_report->keys[i] == code) {
-            break;
-        }
-        if (empty == -1 && keyboard_report->keys[i] == 0) {
-            empty = i;
-        }
+    for (uint8_t i = 1; i < REPORT_SIZE; i++) {
+        keyboard_report->raw[i] = 0;
     }
-    if (i == REPORT_KEYS) {
-        if (empty != -1) {
-            keyboard_report->keys[empty] = code;
+#ifdef NKRO_ENABLE
+    if (keyboard_nkro) {
+        for (uint8_t i = 0; i < REPORT_BITS; i++) {
+            keyboard_report->nkro.bits[i] = key_bits[i];
         }
+        return;
     }
-}
-
-static inline void del_key_byte(uint8_t code)
-{
+#endif
     for (uint8_t i = 0; i < REPORT_KEYS; i++) {
-        if (keyboard_report->keys[i] == code) {
-            keyboard_report->keys[i] = 0;
-        }
+        keyboard_report->keys[i] = key_slots[i];
     }
 }
 
-#ifdef NKRO_ENABLE
-static inline void add_key_bit(uint8_t code)
+static bool report_has_key(report_keyboard_t *report, uint8_t code)
 {
-    if ((code>>3) < REPORT_BITS) {
-        keyboard_report->nkro.bits[code>>3] |= 1<<(code&7);
-    } else {
-        dprintf("add_key_bit: can't add: %02X\n", code);
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+        if (report->keys[i] == code) return true;
     }
+    return false;
 }
 
-static inline void del_key_bit(uint8_t code)
+/* whether anything changed from sent to pend is changed again in next */
+bool keyboard_report_edge_lost(report_keyboard_t *sent, report_keyboard_t *pend, report_keyboard_t *next)
 {
-    if ((code>>3) < REPORT_BITS) {
-        keyboard_report->nkro.bits[code>>3] &= ~(1<<(code&7));
-    } else {
-        dprintf("del_key_bit: can't del: %02X\n", code);
+    if ((sent->mods ^ pend->mods) & (pend->mods ^ next->mods)) return true;
+#ifdef NKRO_ENABLE
+    if (keyboard_nkro) {
+        for (uint8_t i = 0; i < REPORT_BITS; i++) {
+            if ((sent->nkro.bits[i] ^ pend->nkro.bits[i]) & (pend->nkro.bits[i] ^ next->nkro.bits[i]))
+                return true;
+        }
+        return false;
     }
-}
 #endif
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+        // pressed and released
+        uint8_t code = pend->keys[i];
+        if (code && !report_has_key(sent, code) && !report_has_key(next, code)) return true;
+        // released and pressed
+        code = sent->keys[i];
+        if (code && !report_has_key(pend, code) && report_has_key(next, code)) return true;
+    }
+    return false;
+}
@@ -18,12 +18,27 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define ACTION_UTIL_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "report.h"
 
 extern report_keyboard_t *keyboard_report;
 
 void send_keyboard_report(void);
 
+/* send only one report for changes between begin and end */
+#ifdef BATCH_SCAN_ENABLE
+void keyboard_report_batch_begin(void);
+void keyboard_report_batch_end(void);
+#endif
+
+#ifdef NKRO_ENABLE
+/* release keys in protocol of last report and send held keys in current one */
+void keyboard_report_switch(void);
+#endif
+
+/* whether pend can't be replaced with next without losing a change from sent */
+bool keyboard_report_edge_lost(report_keyboard_t *sent, report_keyboard_t *pend, report_keyboard_t *next);
+
 /* key */
 void add_key(uint8_t key);
 void del_key(uint8_t key);
@@ -43,6 +58,12 @@ void del_weak_mods(uint8_t mods);
 void set_weak_mods(uint8_t mods);
 void clear_weak_mods(void);
 
+/* macro modifier: held after end of macro, and of macro being played */
+uint8_t get_macro_mods(void);
+void set_macro_mods(uint8_t mods);
+void clear_macro_mods(void);
+void set_macro_play_mods(uint8_t mods);
+
 /* oneshot modifier */
 void set_oneshot_mods(uint8_t mods);
 void clear_oneshot_mods(void);
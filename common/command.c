@@ -27,12 +27,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "keyboard.h"
 #include "bootloader.h"
 #include "action_layer.h"
+#include "action_tapping.h"
 #include "action_util.h"
 #include "eeconfig.h"
 #include "sleep_led.h"
 #include "led.h"
 #include "command.h"
 #include "backlight.h"
+#include "profile.h"
 
 #ifdef MOUSEKEY_ENABLE
 #include "mousekey.h"
@@ -45,8 +47,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #   endif
 #endif
 
+#ifdef PROTOCOL_LUFA
+#   include "lufa.h"
+#endif
+
 #ifdef PROTOCOL_VUSB
 #   include "usbdrv.h"
+#   include "vusb.h"
 #endif
 
 
@@ -115,6 +122,9 @@ static void command_common_help(void)
     print("t:	print timer count\n");
     print("s:	print status\n");
     print("e:	print eeprom config\n");
+#ifdef PROFILE_ENABLE
+    print("p:	print and clear profile\n");
+#endif
 #ifdef NKRO_ENABLE
     print("n:	toggle NKRO\n");
 #endif
@@ -298,11 +308,22 @@ static bool command_common(uint8_t code)
         case KC_T: // print timer
             print_val_hex32(timer_count);
             break;
+#ifdef PROFILE_ENABLE
+        case KC_P:
+            profile_print();
+            profile_clear();
+            break;
+#endif
         case KC_S:
             print("\n\n----- Status -----\n");
             print_val_hex8(host_keyboard_leds());
             print_val_hex8(keyboard_protocol);
             print_val_hex8(keyboard_idle);
+            print_val_dec(keyboard_scan_rate());
+#ifndef NO_ACTION_TAPPING
+            print_val_dec(waiting_buffer_peak());
+            print_val_dec(waiting_buffer_overflow_settled());
+#endif
 #ifdef PROTOCOL_PJRC
             print_val_hex8(UDCON);
             print_val_hex8(UDIEN);
@@ -315,12 +336,24 @@ static bool command_common(uint8_t code)
 #   if USB_COUNT_SOF
             print_val_hex8(usbSofCount);
 #   endif
+#endif
+#ifdef PROTOCOL_LUFA
+            print_val_dec(keyboard_queue_peak);
+            print_val_dec(keyboard_queue_merged);
+            print_val_dec(report_queue_dropped);
+#endif
+#ifdef PROTOCOL_VUSB
+            print_val_dec(vusb_kbuf_used());
+            print_val_dec(vusb_kbuf_peak);
+            print_val_dec(vusb_kbuf_coalesced);
+            print_val_dec(vusb_kbuf_dropped);
 #endif
             break;
 #ifdef NKRO_ENABLE
         case KC_N:
-            clear_keyboard(); //Prevents stuck keys.
             keyboard_nkro = !keyboard_nkro;
+            // release keys on old interface before sending them on new one
+            keyboard_report_switch();
             if (keyboard_nkro)
                 print("NKRO: enabled\n");
             else
@@ -421,6 +454,7 @@ static void mousekey_param_print(void)
     print("4: mk_time_to_max: "); pdec(mk_time_to_max); print("\n");
     print("5: mk_wheel_max_speed: "); pdec(mk_wheel_max_speed); print("\n");
     print("6: mk_wheel_time_to_max: "); pdec(mk_wheel_time_to_max); print("\n");
+    print("7: mk_curve(0:linear 1:quadratic 2:exponential): "); pdec(mk_curve); print("\n");
 }
 
 #define PRINT_SET_VAL(v)  print(#v " = "); print_dec(v); print("\n");
@@ -469,6 +503,13 @@ static void mousekey_param_inc(uint8_t param, uint8_t inc)
                 mk_wheel_time_to_max = UINT8_MAX;
             PRINT_SET_VAL(mk_wheel_time_to_max);
             break;
+        case 7:
+            if (mk_curve + inc < MOUSEKEY_CURVE_EXPONENTIAL)
+                mk_curve += inc;
+            else
+                mk_curve = MOUSEKEY_CURVE_EXPONENTIAL;
+            PRINT_SET_VAL(mk_curve);
+            break;
     }
 }
 
@@ -517,6 +558,13 @@ static void mousekey_param_dec(uint8_t param, uint8_t dec)
                 mk_wheel_time_to_max = 0;
             PRINT_SET_VAL(mk_wheel_time_to_max);
             break;
+        case 7:
+            if (mk_curve > dec)
+                mk_curve -= dec;
+            else
+                mk_curve = 0;
+            PRINT_SET_VAL(mk_curve);
+            break;
     }
 }
 
@@ -530,13 +578,14 @@ static void mousekey_console_help(void)
     print("4:	select mk_time_to_max\n");
     print("5:	select mk_wheel_max_speed\n");
     print("6:	select mk_wheel_time_to_max\n");
+    print("7:	select mk_curve\n");
     print("p:	print prameters\n");
     print("d:	set default values\n");
     print("up:	increase prameters(+1)\n");
     print("down:	decrease prameters(-1)\n");
     print("pgup:	increase prameters(+10)\n");
     print("pgdown:	decrease prameters(-10)\n");
-    print("\nspeed = delta * max_speed * (repeat / time_to_max)\n");
+    print("\nspeed = delta * max_speed * curve(repeat / time_to_max)\n");
     print("where delta: cursor="); pdec(MOUSEKEY_MOVE_DELTA);
     print(", wheel="); pdec(MOUSEKEY_WHEEL_DELTA); print("\n");
     print("See http://en.wikipedia.org/wiki/Mouse_keys\n");
@@ -591,6 +640,7 @@ static bool mousekey_console(uint8_t code)
             mk_time_to_max = MOUSEKEY_TIME_TO_MAX;
             mk_wheel_max_speed = MOUSEKEY_WHEEL_MAX_SPEED;
             mk_wheel_time_to_max = MOUSEKEY_WHEEL_TIME_TO_MAX;
+            mk_curve = MOUSEKEY_CURVE;
             print("set default values.\n");
             break;
         default:
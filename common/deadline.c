@@ -0,0 +1,73 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "deadline.h"
+
+
+static deadline_func_t deadline_funcs[DEADLINE_NUM];
+static uint16_t deadline_times[DEADLINE_NUM];
+static uint8_t deadline_active = 0;
+
+/* time has passed deadline */
+#define DEADLINE_PASSED(now, time)  ((int16_t)((now) - (time)) >= 0)
+
+
+void deadline_register(uint8_t id, deadline_func_t func)
+{
+    deadline_funcs[id] = func;
+}
+
+void deadline_set(uint8_t id, uint16_t time)
+{
+    deadline_times[id] = time;
+    deadline_active |= (1<<id);
+}
+
+void deadline_clear(uint8_t id)
+{
+    deadline_active &= ~(1<<id);
+}
+
+void deadline_task(void)
+{
+    if (!deadline_active) return;
+
+    uint16_t now = timer_read();
+    for (uint8_t id = 0; id < DEADLINE_NUM; id++) {
+        if ((deadline_active & (1<<id)) && DEADLINE_PASSED(now, deadline_times[id])) {
+            deadline_active &= ~(1<<id);
+            if (deadline_funcs[id]) (*deadline_funcs[id])();
+        }
+    }
+}
+
+uint16_t deadline_next(void)
+{
+    if (!deadline_active) return DEADLINE_NONE;
+
+    uint16_t now = timer_read();
+    uint16_t next = DEADLINE_NONE;
+    for (uint8_t id = 0; id < DEADLINE_NUM; id++) {
+        if (!(deadline_active & (1<<id))) continue;
+        if (DEADLINE_PASSED(now, deadline_times[id])) return 0;
+        uint16_t t = deadline_times[id] - now;
+        if (t < next) next = t;
+    }
+    return next;
+}
@@ -0,0 +1,52 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/* Deadline of timed jobs
+ *
+ * Subsystem registers callback for its id and sets deadline in time of
+ * timer_read(). deadline_task() of main loop calls callbacks when their
+ * deadline comes, so that main loop doesn't poll each subsystem and knows
+ * time to next deadline. Deadline is cleared before its callback is called,
+ * set it again in the callback to repeat. It must be within 32767ms.
+ */
+enum deadline_id {
+    DEADLINE_TAPPING,   // end of tapping term
+    DEADLINE_MACRO,     // next command of macro player
+    DEADLINE_MOUSEKEY,  // next move of mouse keys
+    DEADLINE_NUM
+};
+
+#define DEADLINE_NONE   UINT16_MAX
+
+typedef void (*deadline_func_t)(void);
+
+
+void deadline_register(uint8_t id, deadline_func_t func);
+void deadline_set(uint8_t id, uint16_t time);
+void deadline_clear(uint8_t id);
+/* call callbacks whose deadline has come */
+void deadline_task(void);
+/* milli-seconds to next deadline, 0 if it has come, DEADLINE_NONE if nothing */
+uint16_t deadline_next(void);
+
+#endif
@@ -0,0 +1,163 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "debounce.h"
+
+
+#if DEBOUNCE > 0
+#ifdef DEBOUNCE_TIME_US
+/* time is counted in 128us from micro-second timer, not in milli-seconds */
+#define DEBOUNCE_COUNT  ((DEBOUNCE * 1000UL + 64) / 128)
+#if DEBOUNCE_COUNT > 255
+#   error "DEBOUNCE must be up to 32(ms) with DEBOUNCE_TIME_US"
+#endif
+static uint32_t debounce_time = 0;
+
+/* units of 128us since last call, up to 255 */
+static uint8_t debounce_elapsed(void)
+{
+    uint32_t elapsed = timer_elapsed_us(debounce_time) >> 7;
+    debounce_time += elapsed << 7;
+    return (elapsed > 255 ? 255 : elapsed);
+}
+
+#define debounce_time_init()    (debounce_time = timer_read_us())
+#else
+#define DEBOUNCE_COUNT  DEBOUNCE
+static uint16_t debounce_time = 0;
+
+/* milli-seconds since last call, up to 255 */
+static uint8_t debounce_elapsed(void)
+{
+    uint16_t elapsed = timer_elapsed(debounce_time);
+    debounce_time += elapsed;
+    return (elapsed > 255 ? 255 : elapsed);
+}
+
+#define debounce_time_init()    (debounce_time = timer_read())
+#endif
+#endif
+
+
+#if DEBOUNCE == 0
+void debounce_init(void)
+{
+}
+
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[])
+{
+    bool changed = false;
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        if (cooked[row] != raw[row]) {
+            cooked[row] = raw[row];
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+#elif defined(DEBOUNCE_SYM_PER_ROW)
+/* last raw state and remaining time to settle per row, 0 when settled */
+static matrix_row_t debounce_raw[MATRIX_ROWS];
+static uint8_t debounce_count[MATRIX_ROWS];
+
+void debounce_init(void)
+{
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        debounce_raw[row] = 0;
+        debounce_count[row] = 0;
+    }
+    debounce_time_init();
+}
+
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[])
+{
+    uint8_t elapsed = debounce_elapsed();
+    bool changed = false;
+
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        if (debounce_raw[row] != raw[row]) {
+            debounce_raw[row] = raw[row];
+            debounce_count[row] = DEBOUNCE_COUNT;
+        } else if (debounce_count[row]) {
+            if (debounce_count[row] > elapsed) {
+                debounce_count[row] -= elapsed;
+            } else {
+                debounce_count[row] = 0;
+                if (cooked[row] != raw[row]) {
+                    cooked[row] = raw[row];
+                    changed = true;
+                }
+            }
+        }
+    }
+    return changed;
+}
+
+#else
+/* keys whose raw state differs from debounced one and remaining time to settle */
+static matrix_row_t debounce_counting[MATRIX_ROWS];
+static uint8_t debounce_count[MATRIX_ROWS][MATRIX_COLS];
+
+void debounce_init(void)
+{
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        debounce_counting[row] = 0;
+    }
+    debounce_time_init();
+}
+
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[])
+{
+    uint8_t elapsed = debounce_elapsed();
+    bool changed = false;
+
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        matrix_row_t diff = raw[row] ^ cooked[row];
+        // keys back to debounced state cancel their settlement
+        debounce_counting[row] &= diff;
+        if (!diff) continue;
+
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            matrix_row_t bit = (matrix_row_t)1<<col;
+            if (!(diff & bit)) continue;
+
+#ifndef DEBOUNCE_SYM_PER_KEY
+            // eager press
+            if (raw[row] & bit) {
+                cooked[row] |= bit;
+                changed = true;
+                continue;
+            }
+#endif
+            if (!(debounce_counting[row] & bit)) {
+                debounce_counting[row] |= bit;
+                debounce_count[row][col] = DEBOUNCE_COUNT;
+            } else if (debounce_count[row][col] > elapsed) {
+                debounce_count[row][col] -= elapsed;
+            } else {
+                debounce_counting[row] &= ~bit;
+                cooked[row] ^= bit;
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+#endif
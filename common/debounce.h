@@ -0,0 +1,61 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "matrix.h"
+
+
+/* Debounce
+ *
+ * Matrix scan reads raw switch state into an array and gives it to
+ * debounce() with debounced matrix, which is updated with keys settled.
+ *
+ * DEBOUNCE is time(ms) to settle a change, and algorithm is selected with
+ * one of these in config.h:
+ *
+ * (default)            eager press and deferred release per key
+ *                      press is reported at once and release after raw
+ *                      state stays released for DEBOUNCE
+ * DEBOUNCE_SYM_PER_KEY press and release are reported after raw state of
+ *                      the key stays changed for DEBOUNCE
+ * DEBOUNCE_SYM_PER_ROW changes of a row are reported after raw state of the
+ *                      whole row stays for DEBOUNCE, like global debouncing
+ *                      of old matrix.c but per row
+ *
+ * With DEBOUNCE_TIME_US time is counted with timer_read_us() in 128us instead
+ * of milli-second counter, DEBOUNCE is up to 32(ms) then.
+ *
+ * Eager press has least latency but it can't reject noise on idle keys.
+ * Per key algorithms use a byte per key, per row a byte per row.
+ */
+#ifndef DEBOUNCE
+#   define DEBOUNCE 5
+#endif
+
+#if DEBOUNCE > 255
+#   error "DEBOUNCE must be up to 255(ms)"
+#endif
+
+
+void debounce_init(void);
+/* update debounced matrix with raw state, returns true if it is changed */
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[]);
+
+#endif
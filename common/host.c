@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "host.h"
 #include "util.h"
 #include "debug.h"
+#include "profile.h"
 
 
 #ifdef NKRO_ENABLE
@@ -47,11 +48,19 @@ uint8_t host_keyboard_leds(void)
     if (!driver) return 0;
     return (*driver->keyboard_leds)();
 }
+__attribute__ ((weak))
+bool host_keyboard_ready(void)
+{
+    return true;
+}
+
 /* send report */
 void host_keyboard_send(report_keyboard_t *report)
 {
     if (!driver) return;
+    profile_begin(PROFILE_SEND);
     (*driver->send_keyboard)(report);
+    profile_end(PROFILE_SEND);
 
     if (debug_keyboard) {
         dprint("keyboard_report: ");
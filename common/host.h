@@ -47,6 +47,9 @@ void host_mouse_send(report_mouse_t *report);
 void host_system_send(uint16_t data);
 void host_consumer_send(uint16_t data);
 
+/* whether driver can take keyboard reports without loss, macro waits for it */
+bool host_keyboard_ready(void);
+
 uint16_t host_last_sysytem_report(void);
 uint16_t host_last_consumer_report(void);
 
@@ -16,6 +16,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdint.h>
 #include <util/delay.h>
+#ifdef TICKLESS_ENABLE
+#   include <avr/sleep.h>
+#   include <avr/interrupt.h>
+#endif
 #include "keyboard.h"
 #include "matrix.h"
 #include "keymap.h"
@@ -31,6 +35,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "bootmagic.h"
 #include "eeconfig.h"
 #include "backlight.h"
+#include "action_util.h"
+#include "action_macro.h"
+#include "action_tapping.h"
+#include "profile.h"
+#include "deadline.h"
 #ifdef MOUSEKEY_ENABLE
 #   include "mousekey.h"
 #endif
@@ -57,6 +66,50 @@ static bool has_ghost_in_row(uint8_t row)
 #endif
 
 
+/* scans per second, updated every second */
+static uint16_t scan_count = 0;
+static uint16_t scan_rate = 0;
+static uint16_t scan_time = 0;
+
+uint16_t keyboard_scan_rate(void)
+{
+    return scan_rate;
+}
+
+
+#ifdef TICKLESS_ENABLE
+/* Idle sleep
+ * Timer interrupt wakes up every 1ms at latest so that matrix is still
+ * scanned every 1ms while idle, USB interrupts wake up too.
+ */
+__attribute__ ((weak))
+void keyboard_idle_sleep(void)
+{
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+}
+
+/* no key is down nor left to process and no deadline has come, nothing to do
+ * till next timer tick */
+static bool keyboard_is_idle(bool keys)
+{
+    return !keys && !has_anykey() && deadline_next() != 0;
+}
+#endif
+
+
+#ifndef NO_ACTION_TAPPING
+/* pseudo tick event to settle tapping at end of its term */
+static void keyboard_tick(void)
+{
+    action_exec(TICK);
+}
+#endif
+
+
 void keyboard_init(void)
 {
     timer_init();
@@ -72,11 +125,25 @@ void keyboard_init(void)
 #ifdef BACKLIGHT_ENABLE
     backlight_init();
 #endif
+
+#ifndef NO_ACTION_TAPPING
+    deadline_register(DEADLINE_TAPPING, keyboard_tick);
+#endif
+#ifndef NO_ACTION_MACRO
+    deadline_register(DEADLINE_MACRO, action_macro_task);
+#endif
+#ifdef MOUSEKEY_ENABLE
+    deadline_register(DEADLINE_MOUSEKEY, mousekey_task);
+#endif
 }
 
 /*
  * Do keyboard routine jobs: scan mantrix, light LEDs, ...
  * This is repeatedly called as fast as possible.
+ *
+ * A key event is processed per call by default. With BATCH_SCAN_ENABLE all
+ * keys changed in a scan are processed in a call with same timestamp,
+ * row-major and column ascending order, and reported at once.
  */
 void keyboard_task(void)
 {
@@ -84,11 +151,33 @@ void keyboard_task(void)
     static uint8_t led_status = 0;
     matrix_row_t matrix_row = 0;
     matrix_row_t matrix_change = 0;
+#ifdef TICKLESS_ENABLE
+    bool keys = false;  // key down or change on matrix
+#endif
 
+    profile_mark(PROFILE_LOOP);
+    profile_begin(PROFILE_SCAN);
     matrix_scan();
+    profile_end(PROFILE_SCAN);
+    uint16_t time = timer_read() | 1;  /* time should not be 0 */
+#ifdef KEYEVENT_TIME_US
+    uint32_t time_us = timer_read_us();
+#endif
+    scan_count++;
+    if (TIMER_DIFF_16(time, scan_time) >= 1000) {
+        scan_rate = scan_count;
+        scan_count = 0;
+        scan_time = time;
+    }
+#ifdef BATCH_SCAN_ENABLE
+    keyboard_report_batch_begin();
+#endif
     for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
         matrix_row = matrix_get_row(r);
         matrix_change = matrix_row ^ matrix_prev[r];
+#ifdef TICKLESS_ENABLE
+        if (matrix_row || matrix_change) keys = true;
+#endif
         if (matrix_change) {
             if (debug_matrix) matrix_print();
 #ifdef MATRIX_HAS_GHOST
@@ -99,29 +188,38 @@ void keyboard_task(void)
 #endif
             for (uint8_t c = 0; c < MATRIX_COLS; c++) {
                 if (matrix_change & ((matrix_row_t)1<<c)) {
+                    profile_begin(PROFILE_ACTION);
                     action_exec((keyevent_t){
                         .key = (key_t){ .row = r, .col = c },
                         .pressed = (matrix_row & ((matrix_row_t)1<<c)),
-                        .time = (timer_read() | 1) /* time should not be 0 */
+                        .time = time,
+#ifdef KEYEVENT_TIME_US
+                        .time_us = time_us,
+#endif
                     });
+                    profile_end(PROFILE_ACTION);
                     // record a processed key
                     matrix_prev[r] ^= ((matrix_row_t)1<<c);
+#ifndef BATCH_SCAN_ENABLE
                     // process a key per task call
                     goto MATRIX_LOOP_END;
+#endif
                 }
             }
         }
     }
-    // call with pseudo tick event when no real key event.
-    action_exec(TICK);
-
+#ifdef BATCH_SCAN_ENABLE
+    // send one report for all keys changed in this scan
+    keyboard_report_batch_end();
+#else
 MATRIX_LOOP_END:
-
-#ifdef MOUSEKEY_ENABLE
-    // mousekey repeat & acceleration
-    mousekey_task();
 #endif
 
+    // tapping term, rest of macros and mousekey repeat when their time comes
+    profile_begin(PROFILE_DEADLINE);
+    deadline_task();
+    profile_end(PROFILE_DEADLINE);
+
 #ifdef PS2_MOUSE_ENABLE
     ps2_mouse_task();
 #endif
@@ -131,6 +229,17 @@ MATRIX_LOOP_END:
         led_status = host_keyboard_leds();
         keyboard_set_leds(led_status);
     }
+
+#ifdef NKRO_ENABLE
+    // release keys in old protocol and send them in switched one
+    keyboard_report_switch();
+#endif
+
+#ifdef TICKLESS_ENABLE
+    if (keyboard_is_idle(keys)) {
+        keyboard_idle_sleep();
+    }
+#endif
 }
 
 void keyboard_set_leds(uint8_t leds)
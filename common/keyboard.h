@@ -32,11 +32,17 @@ typedef struct {
     uint8_t row;
 } key_t;
 
-/* key event */
+/* key event
+ * With KEYEVENT_TIME_US event has time in micro-seconds too, tapping term
+ * is decided with it instead of time in milli-seconds.
+ */
 typedef struct {
     key_t    key;
     bool     pressed;
     uint16_t time;
+#ifdef KEYEVENT_TIME_US
+    uint32_t time_us;
+#endif
 } keyevent_t;
 
 /* equivalent test of key_t */
@@ -51,16 +57,31 @@ static inline bool IS_PRESSED(keyevent_t event) { return (!IS_NOEVENT(event) &&
 static inline bool IS_RELEASED(keyevent_t event) { return (!IS_NOEVENT(event) && !event.pressed); }
 
 /* Tick event */
+#ifdef KEYEVENT_TIME_US
+#define TICK                    (keyevent_t){           \
+    .key = (key_t){ .row = 255, .col = 255 },           \
+    .pressed = false,                                   \
+    .time = (timer_read() | 1),                         \
+    .time_us = timer_read_us()                          \
+}
+#else
 #define TICK                    (keyevent_t){           \
     .key = (key_t){ .row = 255, .col = 255 },           \
     .pressed = false,                                   \
     .time = (timer_read() | 1)                          \
 }
+#endif
 
 
 void keyboard_init(void);
 void keyboard_task(void);
 void keyboard_set_leds(uint8_t leds);
+/* matrix scans per second */
+uint16_t keyboard_scan_rate(void);
+#ifdef TICKLESS_ENABLE
+/* called at end of keyboard_task() while idle, sleeps until next interrupt by default */
+void keyboard_idle_sleep(void);
+#endif
 
 #ifdef __cplusplus
 }
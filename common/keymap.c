@@ -112,6 +112,13 @@ const macro_t *action_get_macro(keyrecord_t *record, uint8_t id, uint8_t opt)
     return MACRO_NONE;
 }
 
+/* Sub-macro */
+__attribute__ ((weak))
+const macro_t *action_get_submacro(uint8_t id)
+{
+    return MACRO_NONE;
+}
+
 /* Function */
 __attribute__ ((weak))
 void action_function(keyrecord_t *record, uint8_t id, uint8_t opt)
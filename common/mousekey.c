@@ -17,12 +17,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdint.h>
 #include <util/delay.h>
+#include <avr/pgmspace.h>
 #include "keycode.h"
 #include "host.h"
 #include "timer.h"
 #include "print.h"
 #include "debug.h"
 #include "mousekey.h"
+#include "deadline.h"
 
 
 
@@ -30,6 +32,24 @@ static report_mouse_t mouse_report = {};
 static uint8_t mousekey_repeat =  0;
 static uint8_t mousekey_accel = 0;
 
+/* direction of cursor and wheel: -1, 0 or 1 */
+static int8_t move_x = 0, move_y = 0, wheel_v = 0, wheel_h = 0;
+#ifndef MOUSEKEY_INERTIA
+/* fraction of move carried to next report in 1/256 units */
+static uint8_t frac_x = 0, frac_y = 0, frac_v = 0, frac_h = 0;
+#else
+/* velocity in 1/256 units per second and move not reported yet in 1/256 units */
+typedef struct {
+    int32_t vel;
+    int16_t pos;
+} inertia_t;
+
+static inertia_t inertia_x, inertia_y, inertia_v, inertia_h;
+
+/* longest step of integration not to overflow after stall */
+#define INERTIA_STEP_MAX    100
+#endif
+
 static void mousekey_debug(void);
 
 
@@ -37,7 +57,10 @@ static void mousekey_debug(void);
  * Mouse keys  acceleration algorithm
  *  http://en.wikipedia.org/wiki/Mouse_keys
  *
- *  speed = delta * max_speed * (repeat / time_to_max)**((1000+curve)/1000)
+ *  speed = delta * max_speed * curve(repeat / time_to_max)
+ *
+ * Speed is fixed point in 1/256 units and fraction of move is carried
+ * over to next report so that cursor moves smoothly at low speed.
  */
 /* milliseconds between the initial key press and first repeated motion event (0-2550) */
 uint8_t mk_delay = MOUSEKEY_DELAY/10;
@@ -47,8 +70,8 @@ uint8_t mk_interval = MOUSEKEY_INTERVAL;
 uint8_t mk_max_speed = MOUSEKEY_MAX_SPEED;
 /* number of events (count) accelerating to steady speed (0-255) */
 uint8_t mk_time_to_max = MOUSEKEY_TIME_TO_MAX;
-/* ramp used to reach maximum pointer speed (NOT SUPPORTED) */
-//int8_t mk_curve = 0;
+/* ramp used to reach maximum pointer speed */
+uint8_t mk_curve = MOUSEKEY_CURVE;
 /* wheel params */
 uint8_t mk_wheel_max_speed = MOUSEKEY_WHEEL_MAX_SPEED;
 uint8_t mk_wheel_time_to_max = MOUSEKEY_WHEEL_TIME_TO_MAX;
@@ -57,85 +80,217 @@ uint8_t mk_wheel_time_to_max = MOUSEKEY_WHEEL_TIME_TO_MAX;
 static uint16_t last_timer = 0;
 
 
-static uint8_t move_unit(void)
+#ifndef MOUSEKEY_INERTIA
+/* ratio of speed to max speed in 1/256 at every 1/16 of ramp, 256 at end */
+static const uint8_t curves[][16] PROGMEM = {
+    [MOUSEKEY_CURVE_LINEAR] =
+        { 0, 16, 32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224, 240 },
+    [MOUSEKEY_CURVE_QUADRATIC] =
+        { 0, 1, 4, 9, 16, 25, 36, 49, 64, 81, 100, 121, 144, 169, 196, 225 },
+    /* (e^(4x) - 1) / (e^4 - 1) */
+    [MOUSEKEY_CURVE_EXPONENTIAL] =
+        { 0, 1, 3, 5, 8, 12, 17, 23, 31, 41, 53, 70, 91, 118, 153, 198 },
+};
+
+
+/* ratio of speed at repeat in 1/256, interpolated between points of curve */
+static uint16_t ramp(uint8_t time_to_max)
 {
-    uint16_t unit;
+    if (mousekey_repeat >= time_to_max) return 256;
+
+    uint8_t x = ((uint16_t)mousekey_repeat << 8) / time_to_max;
+    uint8_t i = x >> 4;
+    const uint8_t *curve = curves[mk_curve < sizeof(curves)/sizeof(curves[0]) ? mk_curve : 0];
+    uint16_t a = pgm_read_byte(&curve[i]);
+    uint16_t b = (i < 15 ? pgm_read_byte(&curve[i + 1]) : 256);
+    return a + (((b - a) * (x & 0x0F)) >> 4);
+}
+
+/* cursor speed in 1/256 units per report */
+static uint16_t move_unit(void)
+{
+    uint32_t unit;
     if (mousekey_accel & (1<<0)) {
-        unit = (MOUSEKEY_MOVE_DELTA * mk_max_speed)/4;
+        unit = ((uint32_t)MOUSEKEY_MOVE_DELTA * mk_max_speed) << 6;
     } else if (mousekey_accel & (1<<1)) {
-        unit = (MOUSEKEY_MOVE_DELTA * mk_max_speed)/2;
+        unit = ((uint32_t)MOUSEKEY_MOVE_DELTA * mk_max_speed) << 7;
     } else if (mousekey_accel & (1<<2)) {
-        unit = (MOUSEKEY_MOVE_DELTA * mk_max_speed);
+        unit = ((uint32_t)MOUSEKEY_MOVE_DELTA * mk_max_speed) << 8;
     } else if (mousekey_repeat == 0) {
-        unit = MOUSEKEY_MOVE_DELTA;
-    } else if (mousekey_repeat >= mk_time_to_max) {
-        unit = MOUSEKEY_MOVE_DELTA * mk_max_speed;
+        unit = (uint32_t)MOUSEKEY_MOVE_DELTA << 8;
     } else {
-        unit = (MOUSEKEY_MOVE_DELTA * mk_max_speed * mousekey_repeat) / mk_time_to_max;
+        unit = (uint32_t)MOUSEKEY_MOVE_DELTA * mk_max_speed * ramp(mk_time_to_max);
     }
-    return (unit > MOUSEKEY_MOVE_MAX ? MOUSEKEY_MOVE_MAX : (unit == 0 ? 1 : unit));
+    return (unit > (MOUSEKEY_MOVE_MAX<<8) ? (MOUSEKEY_MOVE_MAX<<8) : unit);
 }
 
-static uint8_t wheel_unit(void)
+/* wheel speed in 1/256 units per report, a unit at least */
+static uint16_t wheel_unit(void)
 {
-    uint16_t unit;
+    uint32_t unit;
     if (mousekey_accel & (1<<0)) {
-        unit = (MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed)/4;
+        unit = ((uint32_t)MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed) << 6;
     } else if (mousekey_accel & (1<<1)) {
-        unit = (MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed)/2;
+        unit = ((uint32_t)MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed) << 7;
     } else if (mousekey_accel & (1<<2)) {
-        unit = (MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed);
+        unit = ((uint32_t)MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed) << 8;
     } else if (mousekey_repeat == 0) {
-        unit = MOUSEKEY_WHEEL_DELTA;
-    } else if (mousekey_repeat >= mk_wheel_time_to_max) {
-        unit = MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed;
+        unit = (uint32_t)MOUSEKEY_WHEEL_DELTA << 8;
+    } else {
+        unit = (uint32_t)MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed * ramp(mk_wheel_time_to_max);
+    }
+    return (unit > (MOUSEKEY_WHEEL_MAX<<8) ? (MOUSEKEY_WHEEL_MAX<<8) : (unit < (1<<8) ? (1<<8) : unit));
+}
+
+/* whole units to move in direction, fraction is carried in frac */
+static int8_t axis_move(int8_t dir, uint16_t unit, uint8_t *frac)
+{
+    if (!dir) return 0;
+    uint16_t sum = unit + *frac;
+    *frac = sum & 0xFF;
+    return (sum >> 8) * dir;
+}
+
+/* move at key press, a unit at least */
+static int8_t press_move(int8_t dir, uint16_t unit)
+{
+    return (unit < (1<<8) ? 1 : (unit >> 8)) * dir;
+}
+#else
+/* integrate velocity and move of an axis for dt milli-seconds, returns whole units to move */
+static int8_t inertia_move(inertia_t *axis, int8_t dir, uint16_t accel, uint16_t friction,
+                           uint16_t max_speed, uint16_t dt)
+{
+    int32_t dv;
+    if (dir) {
+        int32_t max = (int32_t)max_speed << 8;
+        dv = ((int32_t)accel * dt << 8) / 1000;
+        axis->vel += (dir > 0 ? dv : -dv);
+        if (axis->vel > max) axis->vel = max;
+        if (axis->vel < -max) axis->vel = -max;
+    } else {
+        // slow down till it stops
+        dv = ((int32_t)friction * dt << 8) / 1000;
+        if (axis->vel > dv) axis->vel -= dv;
+        else if (axis->vel < -dv) axis->vel += dv;
+        else axis->vel = 0;
+    }
+
+    int32_t pos = axis->pos + axis->vel * dt / 1000;
+    int16_t move = pos / 256;
+    if (move > MOUSEKEY_MOVE_MAX || move < -MOUSEKEY_MOVE_MAX) {
+        // drop move beyond report range
+        axis->pos = 0;
+        return (move > 0 ? MOUSEKEY_MOVE_MAX : -MOUSEKEY_MOVE_MAX);
+    }
+    axis->pos = pos - move * 256;
+    return move;
+}
+#endif
+
+/* keys are down or cursor is coasting */
+static bool mousekey_moving(void)
+{
+    if (move_x || move_y || wheel_v || wheel_h) return true;
+#ifdef MOUSEKEY_INERTIA
+    if (inertia_x.vel || inertia_y.vel || inertia_v.vel || inertia_h.vel) return true;
+#endif
+    return false;
+}
+
+/* milli-seconds to next move */
+static uint16_t mousekey_interval(void)
+{
+#ifdef MOUSEKEY_INERTIA
+    return MOUSEKEY_INERTIA_INTERVAL;
+#else
+    return (mousekey_repeat ? mk_interval : mk_delay*10);
+#endif
+}
+
+/* mousekey_task() is called at next move while moving */
+static void mousekey_schedule(void)
+{
+    last_timer = timer_read();
+    if (mousekey_moving()) {
+        deadline_set(DEADLINE_MOUSEKEY, last_timer + mousekey_interval());
     } else {
-        unit = (MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed * mousekey_repeat) / mk_wheel_time_to_max;
+        deadline_clear(DEADLINE_MOUSEKEY);
     }
-    return (unit > MOUSEKEY_WHEEL_MAX ? MOUSEKEY_WHEEL_MAX : (unit == 0 ? 1 : unit));
 }
 
 void mousekey_task(void)
 {
-    if (timer_elapsed(last_timer) < (mousekey_repeat ? mk_interval : mk_delay*10))
+    uint16_t dt = timer_elapsed(last_timer);
+    if (dt < mousekey_interval()) {
+        // interval grew since scheduled(e.g. mk_interval set on console), wait for it
+        if (mousekey_moving())
+            deadline_set(DEADLINE_MOUSEKEY, last_timer + mousekey_interval());
         return;
+    }
 
-    if (mouse_report.x == 0 && mouse_report.y == 0 && mouse_report.v == 0 && mouse_report.h == 0)
+    if (!mousekey_moving())
         return;
 
+#ifdef MOUSEKEY_INERTIA
+    // integrate with time since last move, not with count of calls
+    if (dt > INERTIA_STEP_MAX) dt = INERTIA_STEP_MAX;
+    uint16_t accel = MOUSEKEY_INERTIA_ACCEL;
+    uint16_t max_speed = MOUSEKEY_INERTIA_MAX_SPEED;
+    /* diagonal move [1/sqrt(2) = 181/256] */
+    if (move_x && move_y) {
+        accel = ((uint32_t)accel * 181) >> 8;
+        max_speed = ((uint32_t)max_speed * 181) >> 8;
+    }
+    mouse_report.x = inertia_move(&inertia_x, move_x, accel, MOUSEKEY_INERTIA_FRICTION, max_speed, dt);
+    mouse_report.y = inertia_move(&inertia_y, move_y, accel, MOUSEKEY_INERTIA_FRICTION, max_speed, dt);
+    mouse_report.v = inertia_move(&inertia_v, wheel_v, MOUSEKEY_INERTIA_WHEEL_ACCEL,
+                                  MOUSEKEY_INERTIA_WHEEL_FRICTION, MOUSEKEY_INERTIA_WHEEL_MAX_SPEED, dt);
+    mouse_report.h = inertia_move(&inertia_h, wheel_h, MOUSEKEY_INERTIA_WHEEL_ACCEL,
+                                  MOUSEKEY_INERTIA_WHEEL_FRICTION, MOUSEKEY_INERTIA_WHEEL_MAX_SPEED, dt);
+
+    if (mouse_report.x || mouse_report.y || mouse_report.v || mouse_report.h) {
+        mousekey_send();
+        // move is reported once, not again with button
+        mouse_report.x = mouse_report.y = mouse_report.v = mouse_report.h = 0;
+    } else {
+        mousekey_schedule();
+    }
+#else
     if (mousekey_repeat != UINT8_MAX)
         mousekey_repeat++;
 
-
-    if (mouse_report.x > 0) mouse_report.x = move_unit();
-    if (mouse_report.x < 0) mouse_report.x = move_unit() * -1;
-    if (mouse_report.y > 0) mouse_report.y = move_unit();
-    if (mouse_report.y < 0) mouse_report.y = move_unit() * -1;
-
-    /* diagonal move [1/sqrt(2) = 0.7] */
-    if (mouse_report.x && mouse_report.y) {
-        mouse_report.x *= 0.7;
-        mouse_report.y *= 0.7;
+    uint16_t unit = move_unit();
+    /* diagonal move [1/sqrt(2) = 181/256] */
+    if (move_x && move_y) {
+        unit = ((uint32_t)unit * 181) >> 8;
     }
+    mouse_report.x = axis_move(move_x, unit, &frac_x);
+    mouse_report.y = axis_move(move_y, unit, &frac_y);
 
-    if (mouse_report.v > 0) mouse_report.v = wheel_unit();
-    if (mouse_report.v < 0) mouse_report.v = wheel_unit() * -1;
-    if (mouse_report.h > 0) mouse_report.h = wheel_unit();
-    if (mouse_report.h < 0) mouse_report.h = wheel_unit() * -1;
+    unit = wheel_unit();
+    mouse_report.v = axis_move(wheel_v, unit, &frac_v);
+    mouse_report.h = axis_move(wheel_h, unit, &frac_h);
 
-    mousekey_send();
+    if (mouse_report.x || mouse_report.y || mouse_report.v || mouse_report.h) {
+        mousekey_send();
+    } else {
+        // no whole unit to move yet
+        mousekey_schedule();
+    }
+#endif
 }
 
 void mousekey_on(uint8_t code)
 {
-    if      (code == KC_MS_UP)       mouse_report.y = move_unit() * -1;
-    else if (code == KC_MS_DOWN)     mouse_report.y = move_unit();
-    else if (code == KC_MS_LEFT)     mouse_report.x = move_unit() * -1;
-    else if (code == KC_MS_RIGHT)    mouse_report.x = move_unit();
-    else if (code == KC_MS_WH_UP)    mouse_report.v = wheel_unit();
-    else if (code == KC_MS_WH_DOWN)  mouse_report.v = wheel_unit() * -1;
-    else if (code == KC_MS_WH_LEFT)  mouse_report.h = wheel_unit() * -1;
-    else if (code == KC_MS_WH_RIGHT) mouse_report.h = wheel_unit();
+    if      (code == KC_MS_UP)       move_y = -1;
+    else if (code == KC_MS_DOWN)     move_y =  1;
+    else if (code == KC_MS_LEFT)     move_x = -1;
+    else if (code == KC_MS_RIGHT)    move_x =  1;
+    else if (code == KC_MS_WH_UP)    wheel_v =  1;
+    else if (code == KC_MS_WH_DOWN)  wheel_v = -1;
+    else if (code == KC_MS_WH_LEFT)  wheel_h = -1;
+    else if (code == KC_MS_WH_RIGHT) wheel_h =  1;
     else if (code == KC_MS_BTN1)     mouse_report.buttons |= MOUSE_BTN1;
     else if (code == KC_MS_BTN2)     mouse_report.buttons |= MOUSE_BTN2;
     else if (code == KC_MS_BTN3)     mouse_report.buttons |= MOUSE_BTN3;
@@ -144,18 +299,44 @@ void mousekey_on(uint8_t code)
     else if (code == KC_MS_ACCEL0)   mousekey_accel |= (1<<0);
     else if (code == KC_MS_ACCEL1)   mousekey_accel |= (1<<1);
     else if (code == KC_MS_ACCEL2)   mousekey_accel |= (1<<2);
+
+#ifndef MOUSEKEY_INERTIA
+    /* move at press */
+    switch (code) {
+        case KC_MS_UP:
+        case KC_MS_DOWN:
+            frac_y = 0;
+            mouse_report.y = press_move(move_y, move_unit());
+            break;
+        case KC_MS_LEFT:
+        case KC_MS_RIGHT:
+            frac_x = 0;
+            mouse_report.x = press_move(move_x, move_unit());
+            break;
+        case KC_MS_WH_UP:
+        case KC_MS_WH_DOWN:
+            frac_v = 0;
+            mouse_report.v = press_move(wheel_v, wheel_unit());
+            break;
+        case KC_MS_WH_LEFT:
+        case KC_MS_WH_RIGHT:
+            frac_h = 0;
+            mouse_report.h = press_move(wheel_h, wheel_unit());
+            break;
+    }
+#endif
 }
 
 void mousekey_off(uint8_t code)
 {
-    if      (code == KC_MS_UP       && mouse_report.y < 0) mouse_report.y = 0;
-    else if (code == KC_MS_DOWN     && mouse_report.y > 0) mouse_report.y = 0;
-    else if (code == KC_MS_LEFT     && mouse_report.x < 0) mouse_report.x = 0;
-    else if (code == KC_MS_RIGHT    && mouse_report.x > 0) mouse_report.x = 0;
-    else if (code == KC_MS_WH_UP    && mouse_report.v > 0) mouse_report.v = 0;
-    else if (code == KC_MS_WH_DOWN  && mouse_report.v < 0) mouse_report.v = 0;
-    else if (code == KC_MS_WH_LEFT  && mouse_report.h < 0) mouse_report.h = 0;
-    else if (code == KC_MS_WH_RIGHT && mouse_report.h > 0) mouse_report.h = 0;
+    if      (code == KC_MS_UP       && move_y < 0)  { move_y = 0; mouse_report.y = 0; }
+    else if (code == KC_MS_DOWN     && move_y > 0)  { move_y = 0; mouse_report.y = 0; }
+    else if (code == KC_MS_LEFT     && move_x < 0)  { move_x = 0; mouse_report.x = 0; }
+    else if (code == KC_MS_RIGHT    && move_x > 0)  { move_x = 0; mouse_report.x = 0; }
+    else if (code == KC_MS_WH_UP    && wheel_v > 0) { wheel_v = 0; mouse_report.v = 0; }
+    else if (code == KC_MS_WH_DOWN  && wheel_v < 0) { wheel_v = 0; mouse_report.v = 0; }
+    else if (code == KC_MS_WH_LEFT  && wheel_h < 0) { wheel_h = 0; mouse_report.h = 0; }
+    else if (code == KC_MS_WH_RIGHT && wheel_h > 0) { wheel_h = 0; mouse_report.h = 0; }
     else if (code == KC_MS_BTN1) mouse_report.buttons &= ~MOUSE_BTN1;
     else if (code == KC_MS_BTN2) mouse_report.buttons &= ~MOUSE_BTN2;
     else if (code == KC_MS_BTN3) mouse_report.buttons &= ~MOUSE_BTN3;
@@ -165,7 +346,7 @@ void mousekey_off(uint8_t code)
     else if (code == KC_MS_ACCEL1) mousekey_accel &= ~(1<<1);
     else if (code == KC_MS_ACCEL2) mousekey_accel &= ~(1<<2);
 
-    if (mouse_report.x == 0 && mouse_report.y == 0 && mouse_report.v == 0 && mouse_report.h == 0)
+    if (!move_x && !move_y && !wheel_v && !wheel_h)
         mousekey_repeat = 0;
 }
 
@@ -173,7 +354,7 @@ void mousekey_send(void)
 {
     mousekey_debug();
     host_mouse_send(&mouse_report);
-    last_timer = timer_read();
+    mousekey_schedule();
 }
 
 void mousekey_clear(void)
@@ -181,6 +362,10 @@ void mousekey_clear(void)
     mouse_report = (report_mouse_t){};
     mousekey_repeat = 0;
     mousekey_accel = 0;
+    move_x = move_y = wheel_v = wheel_h = 0;
+#ifdef MOUSEKEY_INERTIA
+    inertia_x = inertia_y = inertia_v = inertia_h = (inertia_t){};
+#endif
 }
 
 static void mousekey_debug(void)
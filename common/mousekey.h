@@ -51,11 +51,51 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MOUSEKEY_WHEEL_TIME_TO_MAX 40
 #endif
 
+/* acceleration curve of mk_curve */
+#define MOUSEKEY_CURVE_LINEAR       0
+#define MOUSEKEY_CURVE_QUADRATIC    1
+#define MOUSEKEY_CURVE_EXPONENTIAL  2
+#ifndef MOUSEKEY_CURVE
+#define MOUSEKEY_CURVE MOUSEKEY_CURVE_LINEAR
+#endif
+
+#ifdef MOUSEKEY_INERTIA
+/* cursor in pixel/s and pixel/s^2 */
+#ifndef MOUSEKEY_INERTIA_ACCEL
+#define MOUSEKEY_INERTIA_ACCEL 2000
+#endif
+#ifndef MOUSEKEY_INERTIA_FRICTION
+#define MOUSEKEY_INERTIA_FRICTION 4000
+#endif
+#ifndef MOUSEKEY_INERTIA_MAX_SPEED
+#define MOUSEKEY_INERTIA_MAX_SPEED 1200
+#endif
+/* wheel in unit/s and unit/s^2 */
+#ifndef MOUSEKEY_INERTIA_WHEEL_ACCEL
+#define MOUSEKEY_INERTIA_WHEEL_ACCEL 100
+#endif
+#ifndef MOUSEKEY_INERTIA_WHEEL_FRICTION
+#define MOUSEKEY_INERTIA_WHEEL_FRICTION 400
+#endif
+#ifndef MOUSEKEY_INERTIA_WHEEL_MAX_SPEED
+#define MOUSEKEY_INERTIA_WHEEL_MAX_SPEED 60
+#endif
+/* milli-seconds between reports, polling interval of mouse endpoint */
+#ifndef MOUSEKEY_INERTIA_INTERVAL
+#   ifdef MOUSE_POLLING_INTERVAL
+#       define MOUSEKEY_INERTIA_INTERVAL MOUSE_POLLING_INTERVAL
+#   else
+#       define MOUSEKEY_INERTIA_INTERVAL 10
+#   endif
+#endif
+#endif
+
 
 uint8_t mk_delay;
 uint8_t mk_interval;
 uint8_t mk_max_speed;
 uint8_t mk_time_to_max;
+uint8_t mk_curve;
 uint8_t mk_wheel_max_speed;
 uint8_t mk_wheel_time_to_max;
 
@@ -0,0 +1,269 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * scan matrix with pin table of config.h, see pin_matrix.h
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+#include "print.h"
+#include "debug.h"
+#include "util.h"
+#include "matrix.h"
+#include "debounce.h"
+#include "pin_matrix.h"
+
+
+/* Settle time after selecting a row(us), calibrate for your board
+ *
+ * With MATRIX_SETTLE_POLL column lines pulled low by keys on a row are polled
+ * after unselecting the row until they are back high, up to
+ * MATRIX_SETTLE_POLL_MAX polls of 1us wait and a read of columns each. Row
+ * without keys down costs nothing then, so most of scans don't wait at all.
+ * Longest wait seen is printed on console with debug matrix, it can be used to
+ * calibrate MATRIX_IO_DELAY for fixed wait.
+ */
+#ifndef MATRIX_IO_DELAY
+#   define MATRIX_IO_DELAY  30
+#endif
+#ifndef MATRIX_SETTLE_POLL_MAX
+#   define MATRIX_SETTLE_POLL_MAX   MATRIX_IO_DELAY
+#endif
+
+static const uint8_t row_pins[MATRIX_ROWS] PROGMEM = MATRIX_ROW_PINS;
+
+/* Column pins are resolved at compile time
+ * Pin tables are constants and are indexed only with constants below, so that
+ * compiler folds them into direct PINx access like hand-written read_cols():
+ * each port with column pins is read once per row and its pins are put to
+ * their columns with constant masks, pins on bit of their own column in one
+ * operation. The tables take neither flash nor RAM.
+ */
+static const uint8_t col_pins[32] = MATRIX_COL_PINS;
+#ifdef MATRIX_COL_PINS_EXTRA
+static const uint8_t col_pins_extra[4][2] = MATRIX_COL_PINS_EXTRA;
+#   define COL_PINS_EXTRA_NUM  (sizeof((const uint8_t[][2])MATRIX_COL_PINS_EXTRA) / 2)
+#else
+static const uint8_t col_pins_extra[4][2];
+#   define COL_PINS_EXTRA_NUM  0
+#endif
+
+#define REPEAT4(m, op, n)   m(n) op m(n + 1) op m(n + 2) op m(n + 3)
+#define REPEAT32(m, op)     REPEAT4(m, op, 0)  op REPEAT4(m, op, 4)  op REPEAT4(m, op, 8)  op \
+                            REPEAT4(m, op, 12) op REPEAT4(m, op, 16) op REPEAT4(m, op, 20) op \
+                            REPEAT4(m, op, 24) op REPEAT4(m, op, 28)
+
+#define COL_ON_PORT(c)      ((c) < MATRIX_COLS && PIN_ADDR(col_pins[c]) == addr)
+#define EXTRA_ON_PORT(i)    ((i) < COL_PINS_EXTRA_NUM && PIN_ADDR(col_pins_extra[i][0]) == addr)
+
+/* pin of port read in pins put to column: masked as is on bit of its column,
+ * tested and set otherwise as shift costs a cycle per bit on AVR */
+#define PIN_TO_COL(pin, col) \
+    (PIN_ADDR(pin) != addr ? 0 : \
+     ((pin) & 7) == (col) ? (matrix_row_t)(pins & PIN_MASK(pin)) : \
+     (pins & PIN_MASK(pin)) ? (matrix_row_t)1 << (col) : 0)
+#define COL_BITS(c)         ((c) < MATRIX_COLS ? PIN_TO_COL(col_pins[c], c) : 0)
+#define EXTRA_BITS(i)       ((i) < COL_PINS_EXTRA_NUM ? PIN_TO_COL(col_pins_extra[i][0], col_pins_extra[i][1]) : 0)
+
+/* columns on port at I/O address addr, addr must be constant */
+static inline __attribute__ ((always_inline)) matrix_row_t read_port(uint8_t addr)
+{
+    if (!(REPEAT32(COL_ON_PORT, ||) || REPEAT4(EXTRA_ON_PORT, ||, 0))) return 0;
+
+    uint8_t pins = ~_SFR_IO8(addr);
+    return REPEAT32(COL_BITS, |) | REPEAT4(EXTRA_BITS, |, 0);
+}
+
+/* Column pin: input with pull-up(DDR:0, PORT:1) */
+static inline __attribute__ ((always_inline)) void init_col(uint8_t pin)
+{
+    PIN_DDR_REG(pin)  &= ~PIN_MASK(pin);
+    PIN_PORT_REG(pin) |=  PIN_MASK(pin);
+}
+#define INIT_COL(c)         do { if ((c) < MATRIX_COLS) init_col(col_pins[c]); } while (0)
+#define INIT_EXTRA(i)       do { if ((i) < COL_PINS_EXTRA_NUM) init_col(col_pins_extra[i][0]); } while (0)
+
+static bool debounced = false;
+#ifdef MATRIX_SETTLE_POLL
+static uint8_t settle_peak = 0;
+#endif
+
+/* matrix state(1:on, 0:off) */
+static matrix_row_t matrix[MATRIX_ROWS];
+static matrix_row_t matrix_raw[MATRIX_ROWS];
+
+static matrix_row_t read_cols(void);
+static void unselect_rows(void);
+static void unselect_row(uint8_t row);
+static void select_row(uint8_t row);
+
+
+inline
+uint8_t matrix_rows(void)
+{
+    return MATRIX_ROWS;
+}
+
+inline
+uint8_t matrix_cols(void)
+{
+    return MATRIX_COLS;
+}
+
+void matrix_init(void)
+{
+    // initialize row and col
+    unselect_rows();
+    REPEAT32(INIT_COL, ;);
+    REPEAT4(INIT_EXTRA, ;, 0);
+
+    // initialize matrix state: all keys off
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        matrix[i] = 0;
+        matrix_raw[i] = 0;
+    }
+    debounce_init();
+}
+
+uint8_t matrix_scan(void)
+{
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        select_row(i);
+#ifdef MATRIX_SETTLE_POLL
+        _delay_us(1);
+#else
+        _delay_us(MATRIX_IO_DELAY);  // without this wait read unstable value.
+#endif
+        matrix_raw[i] = read_cols();
+        unselect_row(i);
+#ifdef MATRIX_SETTLE_POLL
+        // wait for column lines pulled low by this row to rise
+        if (matrix_raw[i]) {
+            uint8_t t = 0;
+            while (t < MATRIX_SETTLE_POLL_MAX && read_cols()) {
+                _delay_us(1);
+                t++;
+            }
+            if (t > settle_peak) {
+                settle_peak = t;
+                if (debug_matrix) { dprintf("settle: %u polls\n", t); }
+            }
+        }
+#endif
+    }
+
+    debounced = debounce(matrix_raw, matrix);
+
+    return 1;
+}
+
+bool matrix_is_modified(void)
+{
+    return debounced;
+}
+
+inline
+bool matrix_is_on(uint8_t row, uint8_t col)
+{
+    return (matrix[row] & ((matrix_row_t)1<<col));
+}
+
+inline
+matrix_row_t matrix_get_row(uint8_t row)
+{
+    return matrix[row];
+}
+
+void matrix_print(void)
+{
+    print("\nr/c 0123456789ABCDEF\n");
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        phex(row); print(": ");
+#if (MATRIX_COLS <= 16)
+        print_bin_reverse16(matrix_get_row(row));
+#else
+        print_bin_reverse32(matrix_get_row(row));
+#endif
+        print("\n");
+    }
+}
+
+uint8_t matrix_key_count(void)
+{
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+#if (MATRIX_COLS <= 16)
+        count += bitpop16(matrix[i]);
+#else
+        count += bitpop32(matrix[i]);
+#endif
+    }
+    return count;
+}
+
+static matrix_row_t read_cols(void)
+{
+    return 0
+#ifdef PINA
+        | read_port(_SFR_IO_ADDR(PINA))
+#endif
+#ifdef PINB
+        | read_port(_SFR_IO_ADDR(PINB))
+#endif
+#ifdef PINC
+        | read_port(_SFR_IO_ADDR(PINC))
+#endif
+#ifdef PIND
+        | read_port(_SFR_IO_ADDR(PIND))
+#endif
+#ifdef PINE
+        | read_port(_SFR_IO_ADDR(PINE))
+#endif
+#ifdef PINF
+        | read_port(_SFR_IO_ADDR(PINF))
+#endif
+        ;
+}
+
+static void unselect_rows(void)
+{
+    // Hi-Z(DDR:0, PORT:0) to unselect
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        uint8_t pin = pgm_read_byte(&row_pins[row]);
+        PIN_DDR_REG(pin)  &= ~PIN_MASK(pin);
+        PIN_PORT_REG(pin) &= ~PIN_MASK(pin);
+    }
+}
+
+static void select_row(uint8_t row)
+{
+    // Output low(DDR:1, PORT:0) to select
+    uint8_t pin = pgm_read_byte(&row_pins[row]);
+    PIN_DDR_REG(pin)  |=  PIN_MASK(pin);
+    PIN_PORT_REG(pin) &= ~PIN_MASK(pin);
+}
+
+static void unselect_row(uint8_t row)
+{
+    // Hi-Z(DDR:0, PORT:0) to unselect
+    uint8_t pin = pgm_read_byte(&row_pins[row]);
+    PIN_DDR_REG(pin)  &= ~PIN_MASK(pin);
+    PIN_PORT_REG(pin) &= ~PIN_MASK(pin);
+}
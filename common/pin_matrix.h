@@ -0,0 +1,52 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PIN_MATRIX_H
+#define PIN_MATRIX_H
+
+#include <avr/io.h>
+
+
+/* Generic row/column matrix scanned with pin table
+ *
+ * Rows are driven low one by one and columns are read with pull-up, switch
+ * on is read as low. Pins are given in config.h:
+ *
+ *     #define MATRIX_ROW_PINS { PIN_D(0), PIN_D(1), PIN_D(2) }
+ *     #define MATRIX_COL_PINS { PIN_F(0), PIN_F(1), PIN_E(6), PIN_C(7) }
+ *
+ * Up to 4 additional column pins can be given with column number, the column
+ * is on when any of its pins is low. This is for boards revised with a pin moved.
+ *
+ *     #define MATRIX_COL_PINS_EXTRA { { PIN_B(7), 8 } }
+ *
+ * Pin is I/O address of PINx in bit 7-3 and bit number in bit 2-0. PINx, DDRx
+ * and PORTx are at consecutive addresses on AVR.
+ */
+#define PIN_A(n)    ((_SFR_IO_ADDR(PINA) << 3) | (n))
+#define PIN_B(n)    ((_SFR_IO_ADDR(PINB) << 3) | (n))
+#define PIN_C(n)    ((_SFR_IO_ADDR(PINC) << 3) | (n))
+#define PIN_D(n)    ((_SFR_IO_ADDR(PIND) << 3) | (n))
+#define PIN_E(n)    ((_SFR_IO_ADDR(PINE) << 3) | (n))
+#define PIN_F(n)    ((_SFR_IO_ADDR(PINF) << 3) | (n))
+
+#define PIN_ADDR(pin)       ((pin) >> 3)
+#define PIN_MASK(pin)       (1 << ((pin) & 7))
+#define PIN_REG(pin)        _SFR_IO8(PIN_ADDR(pin))
+#define PIN_DDR_REG(pin)    _SFR_IO8(PIN_ADDR(pin) + 1)
+#define PIN_PORT_REG(pin)   _SFR_IO8(PIN_ADDR(pin) + 2)
+
+#endif
@@ -0,0 +1,102 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/pgmspace.h>
+#include "timer.h"
+#include "print.h"
+#include "profile.h"
+
+
+#ifdef PROFILE_ENABLE
+static profile_t profiles[PROFILE_NUM];
+static uint32_t profile_start[PROFILE_NUM];
+
+
+static void profile_add(uint8_t id, uint32_t t)
+{
+    profile_t *p = &profiles[id];
+    uint8_t bin = 0;
+    for (uint32_t v = t; v && bin < PROFILE_BINS - 1; v >>= 1) {
+        bin++;
+    }
+    if (p->bins[bin] < UINT16_MAX) p->bins[bin]++;
+    if (p->count == 0 || t < p->min) p->min = t;
+    if (t > p->max) p->max = t;
+    p->total += t;
+    p->count++;
+}
+
+void profile_begin(uint8_t id)
+{
+    profile_start[id] = timer_read_ticks();
+}
+
+void profile_end(uint8_t id)
+{
+    profile_add(id, timer_read_ticks() - profile_start[id]);
+}
+
+void profile_mark(uint8_t id)
+{
+    uint32_t now = timer_read_ticks();
+    if (profile_start[id]) {
+        profile_add(id, now - profile_start[id]);
+    }
+    profile_start[id] = now | 1;
+}
+
+const profile_t *profile_get(uint8_t id)
+{
+    return &profiles[id];
+}
+
+void profile_clear(void)
+{
+    for (uint8_t i = 0; i < PROFILE_NUM; i++) {
+        profiles[i] = (profile_t){ .count = 0 };
+        profile_start[i] = 0;
+    }
+}
+
+#ifndef NO_PRINT
+static const char profile_names[PROFILE_NUM][9] PROGMEM = {
+    "loop", "scan", "action", "send", "deadline"
+};
+#endif
+
+void profile_print(void)
+{
+#ifndef NO_PRINT
+    print("\n\n----- Profile(us) -----\n");
+    for (uint8_t i = 0; i < PROFILE_NUM; i++) {
+        profile_t *p = &profiles[i];
+        print_P(profile_names[i]);
+        xprintf(": count %lu, min %lu, avg %lu, max %lu\n",
+                p->count,
+                p->min * PROFILE_TICK_NS / 1000,
+                (p->count ? p->total / p->count * PROFILE_TICK_NS / 1000 : 0),
+                p->max * PROFILE_TICK_NS / 1000);
+        print(" bins(2^n ticks):");
+        for (uint8_t b = 0; b < PROFILE_BINS; b++) {
+            xprintf(" %u", p->bins[b]);
+        }
+        print("\n");
+    }
+#endif
+}
+#endif
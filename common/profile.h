@@ -0,0 +1,72 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include "timer.h"
+
+
+/* Profile of main loop
+ *
+ * Time of each part is measured with timer_read_ticks() and kept in min/avg/max
+ * and histogram. Print with 'p' command of console.
+ */
+enum profile_id {
+    PROFILE_LOOP,       // interval of keyboard_task() calls
+    PROFILE_SCAN,       // matrix_scan()
+    PROFILE_ACTION,     // action_exec() of key event
+    PROFILE_SEND,       // send_keyboard of host driver
+    PROFILE_DEADLINE,   // deadline_task()
+    PROFILE_NUM
+};
+
+/* nano-seconds per tick */
+#ifndef PROFILE_TICK_NS
+#   define PROFILE_TICK_NS  (1000000000UL / TIMER_RAW_FREQ)
+#endif
+
+/* bin n counts time of [2^(n-1), 2^n) ticks and bin 0 zero tick,
+ * last bin counts longer time too */
+#define PROFILE_BINS    16
+
+typedef struct {
+    uint32_t count;
+    uint32_t total;
+    uint32_t min;
+    uint32_t max;
+    uint16_t bins[PROFILE_BINS];
+} profile_t;
+
+
+#ifdef PROFILE_ENABLE
+void profile_begin(uint8_t id);
+void profile_end(uint8_t id);
+/* time since last mark */
+void profile_mark(uint8_t id);
+const profile_t *profile_get(uint8_t id);
+void profile_clear(void);
+void profile_print(void);
+#else
+#define profile_begin(id)
+#define profile_end(id)
+#define profile_mark(id)
+#define profile_clear()
+#define profile_print()
+#endif
+
+#endif
@@ -57,56 +57,95 @@ void timer_clear(void)
     SREG = sreg;
 }
 
-inline
-uint16_t timer_read(void)
+/* Lock-free read of timer_count
+ * Interrupt is not disabled to read. Count is read again and retried if
+ * it is changed by ISR in the middle of read, which happens at most once
+ * since ISR runs every 1ms. Low word is enough for 16-bit timer and read
+ * with two bytes instead of four.
+ */
+static inline uint32_t timer_count32(void)
 {
     uint32_t t;
+    do {
+        t = timer_count;
+    } while (t != timer_count);
+    return t;
+}
 
-    uint8_t sreg = SREG;
-    cli();
-    t = timer_count;
-    SREG = sreg;
+static inline uint16_t timer_count16(void)
+{
+    volatile uint16_t *low = (volatile uint16_t *)&timer_count;    // little endian
+    uint16_t t;
+    do {
+        t = *low;
+    } while (t != *low);
+    return t;
+}
 
-    return (t & 0xFFFF);
+inline
+uint16_t timer_read(void)
+{
+    return timer_count16();
 }
 
 inline
 uint32_t timer_read32(void)
 {
-    uint32_t t;
-
-    uint8_t sreg = SREG;
-    cli();
-    t = timer_count;
-    SREG = sreg;
-
-    return t;
+    return timer_count32();
 }
 
 inline
 uint16_t timer_elapsed(uint16_t last)
 {
-    uint32_t t;
-
-    uint8_t sreg = SREG;
-    cli();
-    t = timer_count;
-    SREG = sreg;
-
-    return TIMER_DIFF_16((t & 0xFFFF), last);
+    return TIMER_DIFF_16(timer_count16(), last);
 }
 
 inline
 uint32_t timer_elapsed32(uint32_t last)
+{
+    return TIMER_DIFF_32(timer_count32(), last);
+}
+
+/* ms count and TIMER_RAW at the same time, retried when ISR runs while read */
+static inline void timer_read_raw(uint32_t *count, uint8_t *raw)
+{
+    uint32_t c, t;
+    uint8_t r;
+
+    do {
+        c = timer_count;
+        t = c;
+        r = TIMER_RAW;
+        // compare match not served yet(e.g. interrupt disabled by caller)
+        if (TIFR0 & (1<<OCF0A)) {
+            r = TIMER_RAW;
+            if (r != TIMER_RAW_TOP) t++;
+        }
+    } while (c != timer_count);
+
+    *count = t;
+    *raw = r;
+}
+
+uint32_t timer_read_ticks(void)
 {
     uint32_t t;
+    uint8_t raw;
+    timer_read_raw(&t, &raw);
+    return t * (TIMER_RAW_TOP + 1) + raw;
+}
 
-    uint8_t sreg = SREG;
-    cli();
-    t = timer_count;
-    SREG = sreg;
+uint32_t timer_read_us(void)
+{
+    uint32_t t;
+    uint8_t raw;
+    timer_read_raw(&t, &raw);
+    return t * 1000 + TIMER_RAW_TO_US(raw);
+}
 
-    return TIMER_DIFF_32(t, last);
+uint32_t timer_elapsed_us(uint32_t last)
+{
+    return timer_read_us() - last;
 }
 
 // excecuted once per 1ms.(excess for just timer count?)
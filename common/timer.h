@@ -39,6 +39,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #   error "Timer0 can't count 1ms at this clock freq. Use larger prescaler."
 #endif
 
+/* micro-seconds of TIMER_RAW in 32-bit, raw * 1000 overflows 16-bit int of AVR */
+#define TIMER_RAW_TO_US(raw)    ((uint32_t)(raw) * 1000 / (TIMER_RAW_TOP + 1))
+
 #define TIMER_DIFF(a, b, max)   ((a) >= (b) ?  (a) - (b) : (max) - (b) + (a))
 #define TIMER_DIFF_8(a, b)      TIMER_DIFF(a, b, UINT8_MAX)
 #define TIMER_DIFF_16(a, b)     TIMER_DIFF(a, b, UINT16_MAX)
@@ -59,6 +62,11 @@ uint16_t timer_read(void);
 uint32_t timer_read32(void);
 uint16_t timer_elapsed(uint16_t last);
 uint32_t timer_elapsed32(uint32_t last);
+/* ms count with TIMER_RAW, TIMER_RAW_TOP+1 ticks per ms */
+uint32_t timer_read_ticks(void);
+/* micro-seconds with resolution of TIMER_RAW, wraps around in 71 minutes */
+uint32_t timer_read_us(void);
+uint32_t timer_elapsed_us(uint32_t last);
 
 #ifdef __cplusplus
 }
@@ -15,6 +15,7 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <avr/pgmspace.h>
 #include "util.h"
 
 // bit population - return number of on-bit
@@ -46,25 +47,27 @@ uint8_t bitpop32(uint32_t bits)
     return c;
 }
 
+// most significant on-bit of nibble
+// Byte shifts are cheap on 8-bit AVR while bit shifts of wide integer are not,
+// the last 4 bits are looked up in this table instead.
+static const uint8_t nibble_biton[16] PROGMEM = {
+    0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3
+};
+
 // most significant on-bit - return highest location of on-bit
 // NOTE: return 0 when bit0 is on or all bits are off
 uint8_t biton(uint8_t bits)
 {
     uint8_t n = 0;
     if (bits >> 4) { bits >>= 4; n += 4;}
-    if (bits >> 2) { bits >>= 2; n += 2;}
-    if (bits >> 1) { bits >>= 1; n += 1;}
-    return n;
+    return n + pgm_read_byte(&nibble_biton[bits]);
 }
 
 uint8_t biton16(uint16_t bits)
 {
     uint8_t n = 0;
     if (bits >> 8) { bits >>= 8; n += 8;}
-    if (bits >> 4) { bits >>= 4; n += 4;}
-    if (bits >> 2) { bits >>= 2; n += 2;}
-    if (bits >> 1) { bits >>= 1; n += 1;}
-    return n;
+    return n + biton(bits);
 }
 
 uint8_t biton32(uint32_t bits)
@@ -72,10 +75,7 @@ uint8_t biton32(uint32_t bits)
     uint8_t n = 0;
     if (bits >>16) { bits >>=16; n +=16;}
     if (bits >> 8) { bits >>= 8; n += 8;}
-    if (bits >> 4) { bits >>= 4; n += 4;}
-    if (bits >> 2) { bits >>= 2; n += 2;}
-    if (bits >> 1) { bits >>= 1; n += 1;}
-    return n;
+    return n + biton(bits);
 }
 
 
@@ -31,6 +31,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MATRIX_ROWS 5
 #define MATRIX_COLS 14
 
+/* matrix pins, scanned by common/pin_matrix.c
+ * Rev.B has column 8 on B7 instead of B0
+ */
+#define MATRIX_ROW_PINS { PIN_D(0), PIN_D(1), PIN_D(2), PIN_D(3), PIN_D(5) }
+#define MATRIX_COL_PINS { PIN_F(0), PIN_F(1), PIN_E(6), PIN_C(7), PIN_C(6), PIN_B(6), PIN_D(4), \
+                          PIN_B(1), PIN_B(0), PIN_B(5), PIN_B(4), PIN_D(7), PIN_D(6), PIN_B(3) }
+#define MATRIX_COL_PINS_EXTRA { { PIN_B(7), 8 } }
+
 /* define if matrix has ghost */
 //#define MATRIX_HAS_GHOST
 
@@ -0,0 +1,144 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Benchmark of layer_switch_get_action()
+ *
+ * Measures cycles per lookup of all keys with stacks of 2, 8 and 32 active
+ * layers. Layers above 2 are transparent in the native keymap, so that every
+ * lookup searches whole stack down to layer 0 unless action is cached.
+ *
+ * Without cache, search of active layers is also compared with the former
+ * loop which tests all 32 bits of layer state from top.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include "keyboard.h"
+#include "action.h"
+#include "action_layer.h"
+#include "native.h"
+
+
+#define ROUNDS  10000
+
+static volatile uint16_t sink;
+
+static uint64_t bench_lookup(void)
+{
+    uint64_t start = native_cycles();
+    for (uint16_t n = 0; n < ROUNDS; n++) {
+        for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+            for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+                sink = layer_switch_get_action((key_t){ .row = r, .col = c }).code;
+            }
+        }
+    }
+    return (native_cycles() - start) / ((uint64_t)ROUNDS * MATRIX_ROWS * MATRIX_COLS);
+}
+
+#ifndef LAYER_CACHE_ENABLE
+/* former search which tests every bit of layer state */
+static action_t get_action_linear(key_t key)
+{
+    action_t action;
+    uint32_t layers = layer_state | default_layer_state;
+    for (int8_t i = 31; i >= 0; i--) {
+        if (layers & (1UL<<i)) {
+            action = action_for_key(i, key);
+            if (action.code != ACTION_TRANSPARENT) {
+                return action;
+            }
+        }
+    }
+    return action_for_key(0, key);
+}
+
+static uint64_t bench_search(action_t (*get_action)(key_t))
+{
+    uint64_t start = native_cycles();
+    for (uint16_t n = 0; n < ROUNDS; n++) {
+        for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+            for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+                sink = get_action((key_t){ .row = r, .col = c }).code;
+            }
+        }
+    }
+    return (native_cycles() - start) / ((uint64_t)ROUNDS * MATRIX_ROWS * MATRIX_COLS);
+}
+
+static void bench_search_compare(void)
+{
+    static const struct { const char *name; uint32_t state; } states[] = {
+        { "layer 0 only",  0x00000001 },
+        { "layers 0,1",    0x00000003 },
+        { "layers 0,31",   0x80000001 },
+        { "layers 0-7",    0x000000FF },
+        { "layers 0-31",   0xFFFFFFFF },
+    };
+
+    printf("\nsearch of active layers\n");
+    printf("state           linear(cycles)  biton32(cycles)\n");
+    for (uint8_t i = 0; i < sizeof(states)/sizeof(states[0]); i++) {
+        layer_clear();
+        layer_or(states[i].state);
+        uint64_t linear = bench_search(get_action_linear);
+        uint64_t biton = bench_search(layer_switch_get_action);
+        printf("%-14s  %14llu  %15llu\n", states[i].name,
+                (unsigned long long)linear, (unsigned long long)biton);
+    }
+}
+#endif
+
+/* layer change followed by an event, worst case of cache */
+static uint64_t bench_change(uint32_t state)
+{
+    uint64_t start = native_cycles();
+    for (uint16_t n = 0; n < ROUNDS; n++) {
+        layer_or(state);
+        sink = layer_switch_get_action((key_t){ .row = n % MATRIX_ROWS, .col = n % MATRIX_COLS }).code;
+    }
+    return (native_cycles() - start) / ROUNDS;
+}
+
+int main(void)
+{
+    static const struct { uint8_t layers; uint32_t state; } stacks[] = {
+        {  2, 0x00000003 },
+        {  8, 0x000000FF },
+        { 32, 0xFFFFFFFF },
+    };
+
+    keyboard_init();
+#ifdef LAYER_CACHE_ENABLE
+    printf("layer_switch_get_action with LAYER_CACHE_ENABLE\n");
+#else
+    printf("layer_switch_get_action\n");
+#endif
+    printf("layers  lookup(cycles)  change+lookup(cycles)\n");
+    for (uint8_t i = 0; i < sizeof(stacks)/sizeof(stacks[0]); i++) {
+        layer_clear();
+        layer_or(stacks[i].state);
+        uint64_t lookup = bench_lookup();
+        uint64_t change = bench_change(stacks[i].state);
+        printf("%6u  %14llu  %21llu\n", stacks[i].layers,
+                (unsigned long long)lookup, (unsigned long long)change);
+    }
+#ifndef LAYER_CACHE_ENABLE
+    bench_search_compare();
+#endif
+    return 0;
+}
@@ -0,0 +1,43 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+
+#define DESCRIPTION     t.m.k. keyboard firmware native build
+
+/* key matrix size */
+#define MATRIX_ROWS 4
+#define MATRIX_COLS 8
+
+/* needed only for timer.h macros */
+#define F_CPU       16000000
+
+/* features */
+#define MOUSEKEY_ENABLE
+#define MOUSE_ENABLE
+#define EXTRAKEY_ENABLE
+
+/* timer_read_ticks() of native timer.c is in nano-seconds */
+#define PROFILE_TICK_NS 1
+
+/* no console on host; replay prints reports itself */
+#define NO_DEBUG
+#define NO_PRINT
+
+#endif
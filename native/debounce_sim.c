@@ -0,0 +1,189 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Simulate debounce of bouncy switches
+ *
+ * Trace is text with one raw level change per line, '#' starts comment.
+ *
+ *     <time(us)> <row> <col> <d|u|1|0>
+ *
+ * 'd' and 'u' are press and release made by user, '1' and '0' are bounce or
+ * noise. Raw matrix is debounced every SCAN_US like matrix_scan() and changes
+ * of debounced matrix are printed on stdout:
+ *
+ *     <time(us)> <row> <col> <d|u>
+ *
+ * Then latency from user's press and release to the change, changes not made
+ * by user(chatter) and presses or releases not reported(missed) are printed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "matrix.h"
+#include "debounce.h"
+#include "native.h"
+
+
+#define SCAN_US     250
+#define TAIL_US     50000
+
+#if defined(DEBOUNCE_SYM_PER_ROW)
+#   define ALGORITHM   "symmetric per row"
+#elif defined(DEBOUNCE_SYM_PER_KEY)
+#   define ALGORITHM   "symmetric per key"
+#else
+#   define ALGORITHM   "eager per key"
+#endif
+#ifdef DEBOUNCE_TIME_US
+#   define TIMER_UNIT  "us"
+#else
+#   define TIMER_UNIT  "ms"
+#endif
+
+static matrix_row_t raw[MATRIX_ROWS];
+static matrix_row_t cooked[MATRIX_ROWS];
+
+/* user's state of key and time of its change waiting for report */
+static bool intended[MATRIX_ROWS][MATRIX_COLS];
+static bool waiting[MATRIX_ROWS][MATRIX_COLS];
+static uint32_t intended_time[MATRIX_ROWS][MATRIX_COLS];
+
+struct latency {
+    uint32_t count;
+    uint32_t total;
+    uint32_t max;
+};
+static struct latency press, release;
+static uint32_t chatter = 0;
+static uint32_t missed = 0;
+
+
+static void intend(uint32_t t, uint8_t row, uint8_t col, bool on)
+{
+    if (waiting[row][col]) missed++;
+    intended[row][col] = on;
+    waiting[row][col] = true;
+    intended_time[row][col] = t;
+}
+
+static void report(uint32_t t, uint8_t row, uint8_t col, bool on)
+{
+    printf("%8u %u %u %c\n", t, row, col, (on ? 'd' : 'u'));
+    if (waiting[row][col] && intended[row][col] == on) {
+        struct latency *l = (on ? &press : &release);
+        uint32_t d = t - intended_time[row][col];
+        l->count++;
+        l->total += d;
+        if (d > l->max) l->max = d;
+        waiting[row][col] = false;
+    } else {
+        chatter++;
+    }
+}
+
+static void scan(uint32_t t)
+{
+    matrix_row_t last[MATRIX_ROWS];
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        last[row] = cooked[row];
+    }
+
+    native_timer_set_us(t);
+    if (!debounce(raw, cooked)) return;
+
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        matrix_row_t change = last[row] ^ cooked[row];
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (change & ((matrix_row_t)1<<col)) {
+                report(t, row, col, cooked[row] & ((matrix_row_t)1<<col));
+            }
+        }
+    }
+}
+
+static void print_latency(const char *name, struct latency *l)
+{
+    printf("%-8s %3u, latency avg %.2f ms, max %.2f ms\n", name, l->count,
+            (l->count ? l->total / 1000.0 / l->count : 0.0), l->max / 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <trace>\n", argv[0]);
+        return 1;
+    }
+    FILE *fp = fopen(argv[1], "r");
+    if (!fp) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    native_timer_set(0);
+    debounce_init();
+
+    uint32_t t = 0;
+    char line[128];
+    while (fgets(line, sizeof(line), fp)) {
+        uint32_t time;
+        unsigned row, col;
+        char c;
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%u %u %u %c", &time, &row, &col, &c) != 4) continue;
+        if (time < t) {
+            fprintf(stderr, "not in time order: %s", line);
+            return 1;
+        }
+        if (row >= MATRIX_ROWS || col >= MATRIX_COLS) {
+            fprintf(stderr, "invalid key: %s", line);
+            return 1;
+        }
+
+        for (; t < time; t += SCAN_US) {
+            scan(t);
+        }
+
+        if (c == 'd' || c == 'u') {
+            intend(time, row, col, c == 'd');
+        }
+        if (c == 'd' || c == '1') {
+            raw[row] |=  ((matrix_row_t)1<<col);
+        } else {
+            raw[row] &= ~((matrix_row_t)1<<col);
+        }
+    }
+    fclose(fp);
+
+    for (uint32_t end = t + TAIL_US; t < end; t += SCAN_US) {
+        scan(t);
+    }
+
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (waiting[row][col]) missed++;
+        }
+    }
+
+    printf("# %s, DEBOUNCE %u ms, scan %u us, %s timer\n", ALGORITHM, DEBOUNCE, SCAN_US, TIMER_UNIT);
+    print_latency("press:", &press);
+    print_latency("release:", &release);
+    printf("chatter: %3u\n", chatter);
+    printf("missed:  %3u\n", missed);
+    return 0;
+}
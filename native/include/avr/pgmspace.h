@@ -0,0 +1,30 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Native stand-in for avr-libc: flash is ordinary memory on host */
+#ifndef NATIVE_AVR_PGMSPACE_H
+#define NATIVE_AVR_PGMSPACE_H
+
+#include <stdint.h>
+
+#define PROGMEM
+#define PSTR(s)             (s)
+#define pgm_read_byte(p)    (*(const uint8_t *)(p))
+#define pgm_read_word(p)    (*(const uint16_t *)(p))
+#define pgm_read_dword(p)   (*(const uint32_t *)(p))
+
+#endif
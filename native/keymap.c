@@ -0,0 +1,153 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "keycode.h"
+#include "action.h"
+#include "keymap.h"
+#include "report.h"
+
+
+/* Keymap for replay
+ *
+ * Layer 0
+ *   |  Q  |  W  |  E  |  R  |  T  |  Y  |  U  |  I  |
+ *   |  A  |  S  |  D  |  F  |  G  |  H  |  J  |  K  |
+ *   |Shift|  Z  |  X  |  C  |  V  |  B  |  N  |  M  |
+ *   |Ctrl | Fn0 | Fn1 | Fn2 | Fn3 |Space|Enter|BSpc |
+ *
+ * Layer 1 (Fn0: tap Space, hold Layer 1)
+ *   |  1  |  2  |  3  |  4  |  5  |  6  |  7  |  8  |
+ *
+ * Layer 2 (Fn2: momentary)
+ *   | F1  | F2  | F3  | F4  | F5  | F6  | F7  | F8  |
+ *   |McUp |McDn |McLt |McRt |Btn1 |Mute |VolU |VolD |
+ *   | Fn4 | Fn5 | Fn6 | Fn7 | Fn8 | Fn9 |
+ *
+ * Fn1: tap Esc, hold Ctrl
+ * Fn3: Shift+1
+ * Fn4: macro typing "hi" and "a" after 50ms, at interval of 10ms
+ * Fn5: macro typing "hello", sub-macro "A" twice and Mute
+ * Fn6: invalid macro which is not played
+ * Fn7: macro typing Shift+B and Shift+C after 100ms, then clearing mods
+ * Fn8: Alt-Tab macro, Alt is left down on press and Tab released on release
+ * Fn9: macro typing Shift+B with Shift released by KEY_UP
+ */
+#define KEYMAP( \
+    K00, K01, K02, K03, K04, K05, K06, K07, \
+    K10, K11, K12, K13, K14, K15, K16, K17, \
+    K20, K21, K22, K23, K24, K25, K26, K27, \
+    K30, K31, K32, K33, K34, K35, K36, K37  \
+) { \
+    { KC_##K00, KC_##K01, KC_##K02, KC_##K03, KC_##K04, KC_##K05, KC_##K06, KC_##K07 }, \
+    { KC_##K10, KC_##K11, KC_##K12, KC_##K13, KC_##K14, KC_##K15, KC_##K16, KC_##K17 }, \
+    { KC_##K20, KC_##K21, KC_##K22, KC_##K23, KC_##K24, KC_##K25, KC_##K26, KC_##K27 }, \
+    { KC_##K30, KC_##K31, KC_##K32, KC_##K33, KC_##K34, KC_##K35, KC_##K36, KC_##K37 }  \
+}
+
+static const uint8_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
+    KEYMAP(Q,   W,   E,   R,   T,   Y,   U,   I,    \
+           A,   S,   D,   F,   G,   H,   J,   K,    \
+           LSFT,Z,   X,   C,   V,   B,   N,   M,    \
+           LCTL,FN0, FN1, FN2, FN3, SPC, ENT, BSPC),
+    KEYMAP(1,   2,   3,   4,   5,   6,   7,   8,    \
+           TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS, \
+           TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS, \
+           TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS),
+    KEYMAP(F1,  F2,  F3,  F4,  F5,  F6,  F7,  F8,   \
+           MS_U,MS_D,MS_L,MS_R,BTN1,MUTE,VOLU,VOLD, \
+           FN4, FN5, FN6, FN7, FN8, FN9, TRNS,TRNS, \
+           TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,TRNS),
+};
+
+static const uint16_t PROGMEM fn_actions[] = {
+    [0] = ACTION_LAYER_TAP_KEY(1, KC_SPACE),
+    [1] = ACTION_MODS_TAP_KEY(MOD_LCTL, KC_ESC),
+    [2] = ACTION_LAYER_MOMENTARY(2),
+    [3] = ACTION_MODS_KEY(MOD_LSFT, KC_1),
+    [4] = ACTION_MACRO(0),
+    [5] = ACTION_MACRO(1),
+    [6] = ACTION_MACRO(2),
+    [7] = ACTION_MACRO(3),
+    [8] = ACTION_MACRO(4),
+    [9] = ACTION_MACRO(5),
+};
+
+#define KEYMAPS_SIZE    (sizeof(keymaps) / sizeof(keymaps[0]))
+#define FN_ACTIONS_SIZE (sizeof(fn_actions) / sizeof(fn_actions[0]))
+
+/* translates key to keycode */
+uint8_t keymap_key_to_keycode(uint8_t layer, key_t key)
+{
+    if (layer < KEYMAPS_SIZE) {
+        return pgm_read_byte(&keymaps[(layer)][(key.row)][(key.col)]);
+    } else {
+        return KC_TRNS;
+    }
+}
+
+const macro_t *action_get_macro(keyrecord_t *record, uint8_t id, uint8_t opt)
+{
+    switch (id) {
+        case 0:
+            return (record->event.pressed ?
+                    MACRO( I(10), T(H), T(I), W(50), T(A), END ) :
+                    MACRO_NONE );
+        case 1:
+            return (record->event.pressed ?
+                    MACRO( KEYS(KC_H, KC_E, KC_L, KC_L, KC_O),
+                           REPEAT(2), CALL(0), LOOP,
+                           CONSUMER(AUDIO_MUTE), CONSUMER(0), END ) :
+                    MACRO_NONE );
+        case 2:
+            return (record->event.pressed ?
+                    MACRO( REPEAT(2), T(A), END ) :
+                    MACRO_NONE );
+        case 3:
+            return (record->event.pressed ?
+                    MACRO( D(LSFT), T(B), W(100), T(C), MODS(0), END ) :
+                    MACRO_NONE );
+        case 4:
+            return (record->event.pressed ?
+                    MACRO( D(LALT), D(TAB), END ) :
+                    MACRO( U(TAB), END ));
+        case 5:
+            return (record->event.pressed ?
+                    MACRO( D(LSFT), T(B), U(LSFT), END ) :
+                    MACRO_NONE );
+    }
+    return MACRO_NONE;
+}
+
+const macro_t *action_get_submacro(uint8_t id)
+{
+    switch (id) {
+        case 0:
+            return MACRO( MODS(MOD_BIT(KC_LSHIFT)), T(A), MODS(0), END );
+    }
+    return MACRO_NONE;
+}
+
+/* translates Fn keycode to action */
+action_t keymap_fn_to_action(uint8_t keycode)
+{
+    action_t action = { .code = ACTION_NO };
+    if (FN_INDEX(keycode) < FN_ACTIONS_SIZE) {
+        action.code = pgm_read_word(&fn_actions[FN_INDEX(keycode)]);
+    }
+    return action;
+}
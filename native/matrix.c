@@ -0,0 +1,85 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "matrix.h"
+#include "native.h"
+
+
+/* Stub matrix
+ * Key switches are set by the harness instead of scanning hardware.
+ */
+static matrix_row_t matrix[MATRIX_ROWS];
+
+void native_matrix_set(uint8_t row, uint8_t col, bool on)
+{
+    if (on) {
+        matrix[row] |=  ((matrix_row_t)1<<col);
+    } else {
+        matrix[row] &= ~((matrix_row_t)1<<col);
+    }
+}
+
+inline
+uint8_t matrix_rows(void)
+{
+    return MATRIX_ROWS;
+}
+
+inline
+uint8_t matrix_cols(void)
+{
+    return MATRIX_COLS;
+}
+
+void matrix_init(void)
+{
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        matrix[i] = 0;
+    }
+}
+
+uint8_t matrix_scan(void)
+{
+    return 1;
+}
+
+bool matrix_is_modified(void)
+{
+    return true;
+}
+
+inline
+bool matrix_is_on(uint8_t row, uint8_t col)
+{
+    return (matrix[row] & ((matrix_row_t)1<<col));
+}
+
+inline
+matrix_row_t matrix_get_row(uint8_t row)
+{
+    return matrix[row];
+}
+
+void matrix_print(void)
+{
+}
+
+void led_set(uint8_t usb_led)
+{
+}
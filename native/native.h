@@ -0,0 +1,49 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/* virtual clock in milli-seconds, advanced only by the harness */
+void native_timer_set(uint32_t ms);
+void native_timer_set_us(uint32_t us);
+
+/* switch state of stub matrix */
+void native_matrix_set(uint8_t row, uint8_t col, bool on);
+
+
+/* CPU cycle counter for benchmark, or nano-seconds where not available */
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t native_cycles(void)
+{
+    return __builtin_ia32_rdtsc();
+}
+#else
+#include <time.h>
+static inline uint64_t native_cycles(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#endif
+
+#endif
@@ -0,0 +1,187 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Check common/pin_matrix.c against hand-written matrix of gh60 which it
+ * replaced: columns read and rows selected with every level of column pins.
+ *
+ * I/O registers of ATmega32U4 are bytes of io[] here, built with config.h of
+ * keyboard/gh60.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static volatile uint8_t io[0x40];
+#define _SFR_IO8(addr)      io[addr]
+#define _SFR_IO_ADDR(sfr)   sfr##_ADDR
+
+#define PINB_ADDR   0x03
+#define PINC_ADDR   0x06
+#define PIND_ADDR   0x09
+#define PINE_ADDR   0x0C
+#define PINF_ADDR   0x0F
+#define PINB    _SFR_IO8(0x03)
+#define DDRB    _SFR_IO8(0x04)
+#define PORTB   _SFR_IO8(0x05)
+#define PINC    _SFR_IO8(0x06)
+#define DDRC    _SFR_IO8(0x07)
+#define PORTC   _SFR_IO8(0x08)
+#define PIND    _SFR_IO8(0x09)
+#define DDRD    _SFR_IO8(0x0A)
+#define PORTD   _SFR_IO8(0x0B)
+#define PINE    _SFR_IO8(0x0C)
+#define DDRE    _SFR_IO8(0x0D)
+#define PORTE   _SFR_IO8(0x0E)
+#define PINF    _SFR_IO8(0x0F)
+#define DDRF    _SFR_IO8(0x10)
+#define PORTF   _SFR_IO8(0x11)
+
+#include "../common/pin_matrix.c"
+
+
+/* read_cols() and select_row() of keyboard/gh60/matrix.c */
+static matrix_row_t gh60_read_cols(void)
+{
+    return (PINF&(1<<0) ? 0 : (1<<0)) |
+           (PINF&(1<<1) ? 0 : (1<<1)) |
+           (PINE&(1<<6) ? 0 : (1<<2)) |
+           (PINC&(1<<7) ? 0 : (1<<3)) |
+           (PINC&(1<<6) ? 0 : (1<<4)) |
+           (PINB&(1<<6) ? 0 : (1<<5)) |
+           (PIND&(1<<4) ? 0 : (1<<6)) |
+           (PINB&(1<<1) ? 0 : (1<<7)) |
+           ((PINB&(1<<0) && PINB&(1<<7)) ? 0 : (1<<8)) |     // Rev.A and B
+           (PINB&(1<<5) ? 0 : (1<<9)) |
+           (PINB&(1<<4) ? 0 : (1<<10)) |
+           (PIND&(1<<7) ? 0 : (1<<11)) |
+           (PIND&(1<<6) ? 0 : (1<<12)) |
+           (PINB&(1<<3) ? 0 : (1<<13));
+}
+
+static void gh60_select_row(uint8_t row)
+{
+    // Output low(DDR:1, PORT:0) to select
+    switch (row) {
+        case 0:
+            DDRD  |= (1<<0);
+            PORTD &= ~(1<<0);
+            break;
+        case 1:
+            DDRD  |= (1<<1);
+            PORTD &= ~(1<<1);
+            break;
+        case 2:
+            DDRD  |= (1<<2);
+            PORTD &= ~(1<<2);
+            break;
+        case 3:
+            DDRD  |= (1<<3);
+            PORTD &= ~(1<<3);
+            break;
+        case 4:
+            DDRD  |= (1<<5);
+            PORTD &= ~(1<<5);
+            break;
+    }
+}
+
+/* column pins of gh60 as bit of port */
+static const struct { uint8_t addr; uint8_t bit; } pins[] = {
+    { PINF_ADDR, 0 }, { PINF_ADDR, 1 }, { PINE_ADDR, 6 }, { PINC_ADDR, 7 },
+    { PINC_ADDR, 6 }, { PINB_ADDR, 6 }, { PIND_ADDR, 4 }, { PINB_ADDR, 1 },
+    { PINB_ADDR, 0 }, { PINB_ADDR, 7 }, { PINB_ADDR, 5 }, { PINB_ADDR, 4 },
+    { PIND_ADDR, 7 }, { PIND_ADDR, 6 }, { PINB_ADDR, 3 },
+};
+#define PINS_NUM    (sizeof(pins) / sizeof(pins[0]))
+
+/* random levels on pins not used for columns, fixed seed */
+static uint32_t rand_state = 1;
+static uint8_t rand8(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 16;
+}
+
+static void set_pins(uint16_t levels)
+{
+    for (uint8_t a = PINB_ADDR; a <= PINF_ADDR; a += 3) {
+        io[a] = rand8();
+    }
+    for (uint8_t i = 0; i < PINS_NUM; i++) {
+        if (levels & (1 << i))
+            io[pins[i].addr] |=  (1 << pins[i].bit);
+        else
+            io[pins[i].addr] &= ~(1 << pins[i].bit);
+    }
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(void)
+{
+    int errors = 0;
+
+    matrix_init();
+    for (uint8_t i = 0; i < PINS_NUM; i++) {
+        uint8_t m = 1 << pins[i].bit;
+        if ((io[pins[i].addr + 1] & m) || !(io[pins[i].addr + 2] & m)) {
+            printf("col pin %u: not input with pull-up\n", i);
+            errors++;
+        }
+    }
+
+    for (uint32_t levels = 0; levels < (1UL << PINS_NUM); levels++) {
+        set_pins(levels);
+        matrix_row_t cols = read_cols();
+        matrix_row_t expect = gh60_read_cols();
+        if (cols != expect) {
+            if (errors++ < 10) printf("levels %04X: read_cols %04X, gh60 %04X\n", levels, cols, expect);
+        }
+    }
+
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        memset((void *)io, 0xAA, sizeof(io));
+        select_row(row);
+        uint8_t ddr = DDRD, port = PORTD;
+        memset((void *)io, 0xAA, sizeof(io));
+        gh60_select_row(row);
+        if (ddr != DDRD || port != PORTD) {
+            printf("row %u: DDRD %02X PORTD %02X, gh60 %02X %02X\n", row, ddr, port, DDRD, PORTD);
+            errors++;
+        }
+    }
+
+    /* time per read, host cycles differ from AVR but show cost of table walk */
+    volatile matrix_row_t sink;
+    uint64_t t = now_ns();
+    for (uint32_t i = 0; i < 10000000; i++) sink = read_cols();
+    uint64_t t1 = now_ns();
+    for (uint32_t i = 0; i < 10000000; i++) sink = gh60_read_cols();
+    uint64_t t2 = now_ns();
+    (void)sink;
+    fprintf(stderr, "read_cols: %.2f ns, gh60: %.2f ns\n", (t1 - t) / 1e7, (t2 - t1) / 1e7);
+
+    printf("pin_matrix: %s\n", errors ? "NG" : "OK");
+    return errors ? 1 : 0;
+}
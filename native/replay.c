@@ -0,0 +1,390 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Replay key event trace through the action engine and dump reports
+ *
+ * Trace is text with one event per line, '#' starts comment.
+ *
+ *     <time(ms)> <row> <col> <d|u>
+ *
+ * With NKRO_ENABLE protocol can be switched like SET_PROTOCOL request of host.
+ *
+ *     <time(ms)> nkro <0|1>
+ *
+ * Events must be in time order. By default an event is given to action_exec()
+ * directly at its time and TICK is given every milli-second between events.
+ * With -s the event switches the stub matrix and keyboard_task() scans it
+ * every milli-second, like firmware main loop.
+ *
+ * Reports are printed on stdout with time of the virtual clock:
+ *
+ *     <time> K <raw bytes of keyboard report>
+ *     <time> M <buttons> <x> <y> <v> <h>
+ *     <time> S <system usage>
+ *     <time> C <consumer usage>
+ *
+ * CPU time per event is printed on stderr. With -l histogram of latency from
+ * key press to first report sent after it is also printed, this includes
+ * time that the press waits for settlement of tap key.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "keyboard.h"
+#include "action.h"
+#include "action_tapping.h"
+#include "host.h"
+#include "timer.h"
+#include "native.h"
+#include "profile.h"
+#include "deadline.h"
+#ifdef MOUSEKEY_ENABLE
+#   include "mousekey.h"
+#endif
+
+
+static uint32_t now = 0;
+static uint32_t report_count = 0;
+
+
+/*
+ * Latency of key press to report
+ */
+#define LATENCY_BIN_MS  10
+#define LATENCY_BINS    32
+#define PENDING_MAX     32
+
+static uint32_t pending[PENDING_MAX];
+static uint8_t pending_count = 0;
+static uint32_t latency_bins[LATENCY_BINS];
+static uint32_t latency_count = 0;
+static uint32_t latency_total = 0;
+static uint32_t latency_max = 0;
+
+static void latency_press(uint32_t time)
+{
+    if (pending_count < PENDING_MAX) pending[pending_count++] = time;
+}
+
+/* presses before report are settled by it */
+static void latency_report(void)
+{
+    for (uint8_t i = 0; i < pending_count; i++) {
+        uint32_t ms = now - pending[i];
+        uint32_t bin = ms / LATENCY_BIN_MS;
+        latency_bins[bin < LATENCY_BINS ? bin : LATENCY_BINS - 1]++;
+        latency_count++;
+        latency_total += ms;
+        if (ms > latency_max) latency_max = ms;
+    }
+    pending_count = 0;
+}
+
+static void latency_print(void)
+{
+    if (!latency_count) return;
+    fprintf(stderr, "latency: %u presses, avg %.1f ms, max %u ms\n", latency_count,
+            (double)latency_total / latency_count, latency_max);
+    for (uint8_t i = 0; i < LATENCY_BINS; i++) {
+        if (!latency_bins[i]) continue;
+        if (i == LATENCY_BINS - 1) {
+            fprintf(stderr, "  >=%3u ms: %5u ", i * LATENCY_BIN_MS, latency_bins[i]);
+        } else {
+            fprintf(stderr, "  %3u-%3u ms: %5u ", i * LATENCY_BIN_MS,
+                    (i + 1) * LATENCY_BIN_MS - 1, latency_bins[i]);
+        }
+        for (uint32_t j = 0; j < latency_bins[i] * 50 / latency_count; j++) fputc('#', stderr);
+        fputc('\n', stderr);
+    }
+}
+
+
+/*
+ * Profile counters of common/profile.c, only with PROFILE_ENABLE
+ */
+#ifdef PROFILE_ENABLE
+static void profile_dump(void)
+{
+    static const char *names[PROFILE_NUM] = { "loop", "scan", "action", "send", "deadline" };
+    for (uint8_t i = 0; i < PROFILE_NUM; i++) {
+        const profile_t *p = profile_get(i);
+        if (!p->count) continue;
+        fprintf(stderr, "profile %-8s: %u, min %u ns, avg %u ns, max %u ns\n", names[i],
+                p->count, p->min, p->total / p->count, p->max);
+        fprintf(stderr, "  bins(2^n ns):");
+        for (uint8_t b = 0; b < PROFILE_BINS; b++) {
+            fprintf(stderr, " %u", p->bins[b]);
+        }
+        fputc('\n', stderr);
+    }
+}
+#endif
+
+
+/*
+ * Idle sleeps of keyboard_task(), only with TICKLESS_ENABLE
+ */
+#ifdef TICKLESS_ENABLE
+static uint32_t idle_count = 0;
+static bool idle_slept = false;
+
+void keyboard_idle_sleep(void)
+{
+    idle_count++;
+    idle_slept = true;
+}
+
+/* print time when loop starts or stops sleeping */
+static bool idle_print = false;
+static bool idle_prev = false;
+
+static void idle_check(void)
+{
+    if (idle_print && idle_slept != idle_prev) {
+        printf("%6u I %u\n", now, idle_slept);
+    }
+    idle_prev = idle_slept;
+    idle_slept = false;
+}
+#endif
+
+
+/*
+ * Recording host driver
+ */
+static uint8_t keyboard_leds(void)
+{
+    return 0;
+}
+
+static void send_keyboard(report_keyboard_t *report)
+{
+    latency_report();
+    report_count++;
+#ifdef NKRO_ENABLE
+    // N: report on NKRO interface, K: boot keyboard
+    printf("%6u %c", now, (keyboard_nkro ? 'N' : 'K'));
+#else
+    printf("%6u K", now);
+#endif
+    for (uint8_t i = 0; i < REPORT_SIZE; i++) {
+        printf(" %02X", report->raw[i]);
+    }
+    printf("\n");
+}
+
+static void send_mouse(report_mouse_t *report)
+{
+    latency_report();
+    report_count++;
+    printf("%6u M %02X %d %d %d %d\n", now, report->buttons,
+            report->x, report->y, report->v, report->h);
+}
+
+static void send_system(uint16_t data)
+{
+    latency_report();
+    report_count++;
+    printf("%6u S %04X\n", now, data);
+}
+
+static void send_consumer(uint16_t data)
+{
+    latency_report();
+    report_count++;
+    printf("%6u C %04X\n", now, data);
+}
+
+static host_driver_t native_driver = {
+    keyboard_leds,
+    send_keyboard,
+    send_mouse,
+    send_system,
+    send_consumer
+};
+
+
+/*
+ * CPU time
+ */
+static uint64_t clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+typedef struct {
+    uint32_t count;
+    uint64_t total;
+    uint64_t max;
+} cpu_stat_t;
+
+static cpu_stat_t event_stat = {};
+static cpu_stat_t loop_stat = {};
+
+static void cpu_stat_add(cpu_stat_t *stat, uint64_t ns)
+{
+    stat->count++;
+    stat->total += ns;
+    if (ns > stat->max) stat->max = ns;
+}
+
+static void cpu_stat_print(const char *name, cpu_stat_t *stat)
+{
+    if (!stat->count) return;
+    fprintf(stderr, "%s: %u calls, avg %llu ns, max %llu ns\n", name, stat->count,
+            (unsigned long long)(stat->total / stat->count),
+            (unsigned long long)stat->max);
+}
+
+
+/*
+ * Main loop
+ */
+static bool scan_mode = false;
+
+/* run firmware loop for a milli-second */
+static void loop_once(void)
+{
+    native_timer_set(now);
+    uint64_t t0 = clock_ns();
+    if (scan_mode) {
+        keyboard_task();
+    } else {
+        deadline_task();
+    }
+    cpu_stat_add(&loop_stat, clock_ns() - t0);
+#ifdef TICKLESS_ENABLE
+    idle_check();
+#endif
+}
+
+static void run_until(uint32_t time)
+{
+    while (now < time) {
+        now++;
+        loop_once();
+    }
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-s] [-l] [-i] [-t tail_ms] [trace]\n", name);
+    fprintf(stderr, "  -s          feed events to matrix and run keyboard_task()\n");
+    fprintf(stderr, "  -l          print histogram of press to report latency\n");
+    fprintf(stderr, "  -i          print time when idle sleep starts(I 1) and stops(I 0)\n");
+    fprintf(stderr, "  -t tail_ms  run time after last event(default: 1000)\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t tail = 1000;
+    bool latency = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "slit:h")) != -1) {
+        switch (opt) {
+            case 's': scan_mode = true; break;
+            case 'l': latency = true; break;
+#ifdef TICKLESS_ENABLE
+            case 'i': idle_print = true; break;
+#endif
+            case 't': tail = strtoul(optarg, NULL, 0); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+
+    FILE *in = stdin;
+    if (optind < argc) {
+        in = fopen(argv[optind], "r");
+        if (!in) { perror(argv[optind]); return 1; }
+    }
+
+    keyboard_init();
+    host_set_driver(&native_driver);
+
+    char line[256];
+    unsigned lineno = 0;
+    while (fgets(line, sizeof(line), in)) {
+        lineno++;
+        char *p = strchr(line, '#');
+        if (p) *p = '\0';
+
+        unsigned time, row, col;
+        char dir;
+#ifdef NKRO_ENABLE
+        unsigned nkro;
+        if (sscanf(line, "%u nkro %u", &time, &nkro) == 2 && time >= now) {
+            run_until(time);
+            keyboard_nkro = nkro;
+            continue;
+        }
+#endif
+        int n = sscanf(line, "%u %u %u %c", &time, &row, &col, &dir);
+        if (n <= 0) continue;
+        if (n != 4 || row >= MATRIX_ROWS || col >= MATRIX_COLS || (dir != 'd' && dir != 'u')) {
+            fprintf(stderr, "%u: invalid event\n", lineno);
+            return 1;
+        }
+        if (time < now) {
+            fprintf(stderr, "%u: time goes back\n", lineno);
+            return 1;
+        }
+
+        if (scan_mode) {
+            // switch changes at the time and is seen by next scan
+            run_until(time);
+            native_matrix_set(row, col, dir == 'd');
+            if (dir == 'd') latency_press(time);
+        } else {
+            run_until(time);
+            if (dir == 'd') latency_press(time);
+            uint64_t t0 = clock_ns();
+            action_exec((keyevent_t){
+                .key = (key_t){ .row = row, .col = col },
+                .pressed = (dir == 'd'),
+                .time = (timer_read() | 1),
+#ifdef KEYEVENT_TIME_US
+                .time_us = timer_read_us(),
+#endif
+            });
+            cpu_stat_add(&event_stat, clock_ns() - t0);
+        }
+    }
+    run_until(now + tail);
+
+    fprintf(stderr, "reports: %u\n", report_count);
+    cpu_stat_print("action_exec(event)", &event_stat);
+    cpu_stat_print(scan_mode ? "keyboard_task" : "deadline_task", &loop_stat);
+#ifndef NO_ACTION_TAPPING
+    fprintf(stderr, "waiting_buffer: peak %u, overflow settled %u\n",
+            waiting_buffer_peak(), waiting_buffer_overflow_settled());
+#endif
+    if (latency) latency_print();
+#ifdef TICKLESS_ENABLE
+    fprintf(stderr, "idle sleep: %u\n", idle_count);
+#endif
+#ifdef PROFILE_ENABLE
+    profile_dump();
+#endif
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <time.h>
+#include "timer.h"
+#include "native.h"
+
+
+/* Virtual clock
+ * Replaces common/timer.c. Time doesn't go unless the harness sets it, so that
+ * replay of a trace gives same result on every run.
+ */
+volatile uint32_t timer_count = 0;
+static uint32_t timer_us = 0;
+
+void native_timer_set(uint32_t ms)
+{
+    timer_count = ms;
+    timer_us = ms * 1000;
+}
+
+void native_timer_set_us(uint32_t us)
+{
+    timer_count = us / 1000;
+    timer_us = us;
+}
+
+void timer_init(void)
+{
+    timer_count = 0;
+    timer_us = 0;
+}
+
+void timer_clear(void)
+{
+    timer_count = 0;
+    timer_us = 0;
+}
+
+uint16_t timer_read(void)
+{
+    return (timer_count & 0xFFFF);
+}
+
+uint32_t timer_read32(void)
+{
+    return timer_count;
+}
+
+uint16_t timer_elapsed(uint16_t last)
+{
+    return TIMER_DIFF_16((timer_count & 0xFFFF), last);
+}
+
+uint32_t timer_elapsed32(uint32_t last)
+{
+    return TIMER_DIFF_32(timer_count, last);
+}
+
+uint32_t timer_read_us(void)
+{
+    return timer_us;
+}
+
+uint32_t timer_elapsed_us(uint32_t last)
+{
+    return timer_us - last;
+}
+
+/* Ticks run on host clock in nano-seconds, not on virtual clock, so that
+ * profile measures CPU time of the engine.
+ */
+uint32_t timer_read_ticks(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
@@ -0,0 +1,82 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Check timer_read_us() of common/timer.c: micro-seconds go up monotonically
+ * through every TIMER_RAW of several milli-seconds, also when compare match
+ * is pending while interrupt is disabled.
+ *
+ * Timer0 registers are variables here and ISR is called to count a ms.
+ */
+#include <stdint.h>
+#include <stdio.h>
+
+static volatile uint8_t TCCR0A, TCCR0B, OCR0A, TIMSK0, TIFR0, TCNT0, SREG;
+#define OCIE0A  1
+#define OCF0A   1
+
+#include "../common/timer.c"
+
+
+/* conversion must be done in 32-bit: int of AVR is 16-bit and 1000 times
+ * TIMER_RAW overflows it, which host int of 32-bit doesn't show */
+_Static_assert(_Generic(TIMER_RAW_TO_US((uint8_t)0), uint32_t: 1, default: 0),
+               "TIMER_RAW_TO_US must be computed in uint32_t");
+
+#define SWEEP_MS    5
+
+int main(void)
+{
+    int errors = 0;
+    uint32_t last = 0;
+    uint32_t n = 0;
+
+    timer_init();
+    timer_clear();
+    for (uint32_t ms = 0; ms < SWEEP_MS; ms++) {
+        for (uint16_t raw = 0; raw <= TIMER_RAW_TOP; raw++) {
+            TIFR0 = 0;
+            TCNT0 = raw;
+            uint32_t us = timer_read_us();
+            uint32_t expect = ms * 1000 + (uint64_t)raw * 1000 / (TIMER_RAW_TOP + 1);
+            if (us != expect) {
+                if (errors++ < 10) printf("%lu ms raw %u: %lu us, expected %lu\n",
+                                          (unsigned long)ms, raw, (unsigned long)us, (unsigned long)expect);
+            }
+            if (n++ && us <= last) {
+                if (errors++ < 10) printf("%lu ms raw %u: %lu us after %lu us\n",
+                                          (unsigned long)ms, raw, (unsigned long)us, (unsigned long)last);
+            }
+            last = us;
+
+            // same time read before ISR counts it: compare match pending
+            if (raw < TIMER_RAW_TOP && ms > 0) {
+                timer_count--;
+                TIFR0 = (1<<OCF0A);
+                if (timer_read_us() != us) {
+                    if (errors++ < 10) printf("%lu ms raw %u: pending match read %lu us\n",
+                                              (unsigned long)ms, raw, (unsigned long)timer_read_us());
+                }
+                timer_count++;
+            }
+        }
+        TIMER0_COMPA_vect();
+    }
+
+    printf("timer: %lu reads, %s\n", (unsigned long)n, errors ? "NG" : "OK");
+    return errors ? 1 : 0;
+}
@@ -151,6 +151,27 @@ typedef struct
 #endif
 
 
+/* Polling interval of endpoints(ms), 1-255 */
+#ifndef KEYBOARD_POLLING_INTERVAL
+#   define KEYBOARD_POLLING_INTERVAL    10
+#endif
+#ifndef NKRO_POLLING_INTERVAL
+#   define NKRO_POLLING_INTERVAL        1
+#endif
+#ifndef MOUSE_POLLING_INTERVAL
+#   define MOUSE_POLLING_INTERVAL       10
+#endif
+#ifndef EXTRAKEY_POLLING_INTERVAL
+#   define EXTRAKEY_POLLING_INTERVAL    10
+#endif
+#if KEYBOARD_POLLING_INTERVAL < 1 || KEYBOARD_POLLING_INTERVAL > 255 || \
+    NKRO_POLLING_INTERVAL < 1 || NKRO_POLLING_INTERVAL > 255 || \
+    MOUSE_POLLING_INTERVAL < 1 || MOUSE_POLLING_INTERVAL > 255 || \
+    EXTRAKEY_POLLING_INTERVAL < 1 || EXTRAKEY_POLLING_INTERVAL > 255
+#   error "Polling interval must be 1-255(ms) for full speed interrupt endpoint."
+#endif
+
+
 #define KEYBOARD_EPSIZE             8
 #define MOUSE_EPSIZE                8
 #define EXTRAKEY_EPSIZE             8
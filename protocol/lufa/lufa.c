@@ -41,6 +41,7 @@
 #include "host_driver.h"
 #include "keyboard.h"
 #include "action.h"
+#include "action_util.h"
 #include "led.h"
 #include "sendchar.h"
 #include "debug.h"
@@ -59,6 +60,8 @@ static uint8_t keyboard_led_stats = 0;
 static report_keyboard_t keyboard_report_sent;
 
 
+static void Report_Task(void);
+
 /* Host driver */
 static uint8_t keyboard_leds(void);
 static void send_keyboard(report_keyboard_t *report);
@@ -179,6 +182,7 @@ void EVENT_USB_Device_WakeUp()
 void EVENT_USB_Device_StartOfFrame(void)
 {
     Console_Task();
+    Report_Task();
 }
 
 /** Event handler for the USB_ConfigurationChanged event.
@@ -312,9 +316,9 @@ void EVENT_USB_Device_ControlRequest(void)
 
                     keyboard_protocol = ((USB_ControlRequest.wValue & 0xFF) != 0x00);
 #ifdef NKRO_ENABLE
+                    // held keys are released in old protocol and sent in new one by keyboard_task()
                     keyboard_nkro = !!keyboard_protocol;
 #endif
-                    clear_keyboard();
                 }
             }
 
@@ -351,109 +355,277 @@ static uint8_t keyboard_leds(void)
     return keyboard_led_stats;
 }
 
-static void send_keyboard(report_keyboard_t *report)
-{
-    uint8_t timeout = 255;
-
-    if (USB_DeviceState != DEVICE_STATE_Configured)
-        return;
+/*
+ * Report queues
+ *
+ * Reports are queued by host driver and written to endpoints by
+ * Report_Task() from main loop and SOF event, so that keyboard_task()
+ * doesn't wait for endpoint. Keyboard and extrakey reports are queued in
+ * order. Mouse movements are added up while buttons don't change.
+ *
+ * When a queue is full new keyboard report replaces the newest queued one
+ * only if that has no key change the new one would undo. Otherwise oldest
+ * report is discarded so that host gets current state, sender never waits
+ * for host. Reports host doesn't take in time are discarded by
+ * Keyboard_Timeout().
+ */
+#if (KEYBOARD_QUEUE_SIZE & (KEYBOARD_QUEUE_SIZE - 1)) || (MOUSE_QUEUE_SIZE & (MOUSE_QUEUE_SIZE - 1)) || \
+    (EXTRAKEY_QUEUE_SIZE & (EXTRAKEY_QUEUE_SIZE - 1))
+#   error "KEYBOARD_QUEUE_SIZE, MOUSE_QUEUE_SIZE and EXTRAKEY_QUEUE_SIZE must be power of two"
+#endif
 
-    /* Select the Keyboard Report Endpoint */
+typedef struct {
+    report_keyboard_t report;
 #ifdef NKRO_ENABLE
-    if (keyboard_nkro) {
-        /* Report protocol - NKRO */
-        Endpoint_SelectEndpoint(NKRO_IN_EPNUM);
+    bool nkro;
+#endif
+} keyboard_queue_t;
 
-        /* Check if write ready for a polling interval around 1ms */
-        while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(4);
-        if (!Endpoint_IsReadWriteAllowed()) return;
+static keyboard_queue_t keyboard_queue[KEYBOARD_QUEUE_SIZE];
+static uint8_t keyboard_queue_head = 0;
+static uint8_t keyboard_queue_tail = 0;
+uint8_t keyboard_queue_peak = 0;
+uint16_t keyboard_queue_merged = 0;
+uint16_t report_queue_dropped = 0;
 
-        /* Write Keyboard Report Data */
-        Endpoint_Write_Stream_LE(report, NKRO_EPSIZE, NULL);
-    }
-    else
+#ifdef MOUSE_ENABLE
+static report_mouse_t mouse_queue[MOUSE_QUEUE_SIZE];
+static uint8_t mouse_queue_head = 0;
+static uint8_t mouse_queue_tail = 0;
 #endif
-    {
-        /* Boot protocol */
-        Endpoint_SelectEndpoint(KEYBOARD_IN_EPNUM);
 
-        /* Check if write ready for a polling interval around 10ms */
-        while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-        if (!Endpoint_IsReadWriteAllowed()) return;
+#ifdef EXTRAKEY_ENABLE
+static report_extra_t extrakey_queue[EXTRAKEY_QUEUE_SIZE];
+static uint8_t extrakey_queue_head = 0;
+static uint8_t extrakey_queue_tail = 0;
+#endif
 
-        /* Write Keyboard Report Data */
-        Endpoint_Write_Stream_LE(report, KEYBOARD_EPSIZE, NULL);
-    }
+#define QUEUE_NEXT(i, size)     (((i) + 1) & ((size) - 1))
 
-    /* Finalize the stream transfer to send the last packet */
-    Endpoint_ClearIN();
+/* Host takes a report in every polling interval. When report is not taken
+ * in 8 intervals host is not listening, then queued reports but last are
+ * discarded so that host gets current state when it comes back.
+ */
+#define KEYBOARD_TIMEOUT    (KEYBOARD_POLLING_INTERVAL * 8)
+#define NKRO_TIMEOUT        (NKRO_POLLING_INTERVAL * 8)
+#define FRAME_DIFF(a, b)    (((a) - (b)) & 0x7FF)
+static uint16_t keyboard_queue_frame = 0;
+
+static void Keyboard_Timeout(uint16_t timeout)
+{
+    if (FRAME_DIFF(USB_Device_GetFrameNumber(), keyboard_queue_frame) < timeout) return;
 
-    keyboard_report_sent = *report;
+    uint8_t last = (keyboard_queue_head - 1) & (KEYBOARD_QUEUE_SIZE - 1);
+    report_queue_dropped += (last - keyboard_queue_tail) & (KEYBOARD_QUEUE_SIZE - 1);
+    keyboard_queue_tail = last;
 }
 
-static void send_mouse(report_mouse_t *report)
+static void Keyboard_Write(void)
 {
+    while (keyboard_queue_tail != keyboard_queue_head) {
+        keyboard_queue_t *q = &keyboard_queue[keyboard_queue_tail];
+#ifdef NKRO_ENABLE
+        if (q->nkro) {
+            /* Report protocol - NKRO */
+            Endpoint_SelectEndpoint(NKRO_IN_EPNUM);
+            if (!Endpoint_IsReadWriteAllowed()) {
+                Keyboard_Timeout(NKRO_TIMEOUT);
+                return;
+            }
+            Endpoint_Write_Stream_LE(&q->report, NKRO_EPSIZE, NULL);
+        }
+        else
+#endif
+        {
+            /* Boot protocol */
+            Endpoint_SelectEndpoint(KEYBOARD_IN_EPNUM);
+            if (!Endpoint_IsReadWriteAllowed()) {
+                Keyboard_Timeout(KEYBOARD_TIMEOUT);
+                return;
+            }
+            Endpoint_Write_Stream_LE(&q->report, KEYBOARD_EPSIZE, NULL);
+        }
+        Endpoint_ClearIN();
+        keyboard_report_sent = q->report;
+        keyboard_queue_tail = QUEUE_NEXT(keyboard_queue_tail, KEYBOARD_QUEUE_SIZE);
+        keyboard_queue_frame = USB_Device_GetFrameNumber();
+    }
+}
+
 #ifdef MOUSE_ENABLE
-    uint8_t timeout = 255;
+static void Mouse_Write(void)
+{
+    Endpoint_SelectEndpoint(MOUSE_IN_EPNUM);
+    while (mouse_queue_tail != mouse_queue_head && Endpoint_IsReadWriteAllowed()) {
+        Endpoint_Write_Stream_LE(&mouse_queue[mouse_queue_tail], sizeof(report_mouse_t), NULL);
+        Endpoint_ClearIN();
+        mouse_queue_tail = QUEUE_NEXT(mouse_queue_tail, MOUSE_QUEUE_SIZE);
+    }
+}
+#endif
 
+#ifdef EXTRAKEY_ENABLE
+static void Extrakey_Write(void)
+{
+    Endpoint_SelectEndpoint(EXTRAKEY_IN_EPNUM);
+    while (extrakey_queue_tail != extrakey_queue_head && Endpoint_IsReadWriteAllowed()) {
+        Endpoint_Write_Stream_LE(&extrakey_queue[extrakey_queue_tail], sizeof(report_extra_t), NULL);
+        Endpoint_ClearIN();
+        extrakey_queue_tail = QUEUE_NEXT(extrakey_queue_tail, EXTRAKEY_QUEUE_SIZE);
+    }
+}
+#endif
+
+/* write queued reports to endpoints which are ready */
+static void Report_Task(void)
+{
     if (USB_DeviceState != DEVICE_STATE_Configured)
         return;
 
-    /* Select the Mouse Report Endpoint */
-    Endpoint_SelectEndpoint(MOUSE_IN_EPNUM);
-
-    /* Check if write ready for a polling interval around 10ms */
-    while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-    if (!Endpoint_IsReadWriteAllowed()) return;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t ep = Endpoint_GetCurrentEndpoint();
+        Keyboard_Write();
+#ifdef MOUSE_ENABLE
+        Mouse_Write();
+#endif
+#ifdef EXTRAKEY_ENABLE
+        Extrakey_Write();
+#endif
+        Endpoint_SelectEndpoint(ep);
+    }
+}
 
-    /* Write Mouse Report Data */
-    Endpoint_Write_Stream_LE(report, sizeof(report_mouse_t), NULL);
+/* macro player waits while queue can't take reports of a macro command,
+ * KEYS queues up to three and protocol switch one more */
+bool host_keyboard_ready(void)
+{
+    uint8_t used = (keyboard_queue_head - keyboard_queue_tail) & (KEYBOARD_QUEUE_SIZE - 1);
+    return (KEYBOARD_QUEUE_SIZE - 1 - used) >= 4;
+}
 
-    /* Finalize the stream transfer to send the last packet */
-    Endpoint_ClearIN();
+/* returns false when queue is full and report can't replace newest one */
+static bool keyboard_queue_put(report_keyboard_t *report)
+{
+    bool queued = true;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t next = QUEUE_NEXT(keyboard_queue_head, KEYBOARD_QUEUE_SIZE);
+        uint8_t last = (keyboard_queue_head - 1) & (KEYBOARD_QUEUE_SIZE - 1);
+        if (next == keyboard_queue_tail) {
+            report_keyboard_t *prev = (last == keyboard_queue_tail) ? &keyboard_report_sent :
+                                      &keyboard_queue[(last - 1) & (KEYBOARD_QUEUE_SIZE - 1)].report;
+#ifdef NKRO_ENABLE
+            if (keyboard_queue[last].nkro != keyboard_nkro) {
+                queued = false;
+            } else
 #endif
+            if (keyboard_report_edge_lost(prev, &keyboard_queue[last].report, report)) {
+                queued = false;
+            } else {
+                /* newest report is only an intermediate state */
+                keyboard_queue[last].report = *report;
+                keyboard_queue_merged++;
+            }
+        } else {
+            if (keyboard_queue_head == keyboard_queue_tail) {
+                keyboard_queue_frame = USB_Device_GetFrameNumber();
+            }
+            keyboard_queue[keyboard_queue_head].report = *report;
+#ifdef NKRO_ENABLE
+            keyboard_queue[keyboard_queue_head].nkro = keyboard_nkro;
+#endif
+            keyboard_queue_head = next;
+            uint8_t used = (keyboard_queue_head - keyboard_queue_tail) & (KEYBOARD_QUEUE_SIZE - 1);
+            if (used > keyboard_queue_peak) keyboard_queue_peak = used;
+        }
+    }
+    return queued;
 }
 
-static void send_system(uint16_t data)
+static void send_keyboard(report_keyboard_t *report)
 {
-    uint8_t timeout = 255;
-
     if (USB_DeviceState != DEVICE_STATE_Configured)
         return;
 
-    report_extra_t r = {
-        .report_id = REPORT_ID_SYSTEM,
-        .usage = data
-    };
-    Endpoint_SelectEndpoint(EXTRAKEY_IN_EPNUM);
+    if (!keyboard_queue_put(report)) {
+        /* Full: write reports endpoint takes now, then discard oldest */
+        Report_Task();
+        if (!keyboard_queue_put(report)) {
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                keyboard_report_sent = keyboard_queue[keyboard_queue_tail].report;
+                keyboard_queue_tail = QUEUE_NEXT(keyboard_queue_tail, KEYBOARD_QUEUE_SIZE);
+                report_queue_dropped++;
+            }
+            keyboard_queue_put(report);
+        }
+    }
+    Report_Task();
+}
 
-    /* Check if write ready for a polling interval around 10ms */
-    while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-    if (!Endpoint_IsReadWriteAllowed()) return;
+static void send_mouse(report_mouse_t *report)
+{
+#ifdef MOUSE_ENABLE
+    if (USB_DeviceState != DEVICE_STATE_Configured)
+        return;
 
-    Endpoint_Write_Stream_LE(&r, sizeof(report_extra_t), NULL);
-    Endpoint_ClearIN();
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t next = QUEUE_NEXT(mouse_queue_head, MOUSE_QUEUE_SIZE);
+        report_mouse_t *last = &mouse_queue[(mouse_queue_head - 1) & (MOUSE_QUEUE_SIZE - 1)];
+        bool queued = (mouse_queue_head != mouse_queue_tail);
+        int16_t x = last->x + report->x;
+        int16_t y = last->y + report->y;
+        int16_t v = last->v + report->v;
+        int16_t h = last->h + report->h;
+        if (queued && last->buttons == report->buttons &&
+                -127 <= x && x <= 127 && -127 <= y && y <= 127 &&
+                -127 <= v && v <= 127 && -127 <= h && h <= 127) {
+            /* add movement to queued report */
+            last->x = x; last->y = y; last->v = v; last->h = h;
+        } else if (next == mouse_queue_tail) {
+            /* Full: host doesn't poll, replace newest report with this */
+            *last = *report;
+        } else {
+            mouse_queue[mouse_queue_head] = *report;
+            mouse_queue_head = next;
+        }
+    }
+    Report_Task();
+#endif
 }
 
-static void send_consumer(uint16_t data)
+#ifdef EXTRAKEY_ENABLE
+static void send_extra(uint8_t report_id, uint16_t data)
 {
-    uint8_t timeout = 255;
-
     if (USB_DeviceState != DEVICE_STATE_Configured)
         return;
 
-    report_extra_t r = {
-        .report_id = REPORT_ID_CONSUMER,
-        .usage = data
-    };
-    Endpoint_SelectEndpoint(EXTRAKEY_IN_EPNUM);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t next = QUEUE_NEXT(extrakey_queue_head, EXTRAKEY_QUEUE_SIZE);
+        if (next == extrakey_queue_tail) {
+            /* Full: discard oldest report */
+            extrakey_queue_tail = QUEUE_NEXT(extrakey_queue_tail, EXTRAKEY_QUEUE_SIZE);
+            report_queue_dropped++;
+        }
+        extrakey_queue[extrakey_queue_head].report_id = report_id;
+        extrakey_queue[extrakey_queue_head].usage = data;
+        extrakey_queue_head = next;
+    }
+    Report_Task();
+}
+#endif
 
-    /* Check if write ready for a polling interval around 10ms */
-    while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-    if (!Endpoint_IsReadWriteAllowed()) return;
+static void send_system(uint16_t data)
+{
+#ifdef EXTRAKEY_ENABLE
+    send_extra(REPORT_ID_SYSTEM, data);
+#endif
+}
 
-    Endpoint_Write_Stream_LE(&r, sizeof(report_extra_t), NULL);
-    Endpoint_ClearIN();
+static void send_consumer(uint16_t data)
+{
+#ifdef EXTRAKEY_ENABLE
+    send_extra(REPORT_ID_CONSUMER, data);
+#endif
 }
 
 
@@ -579,6 +751,7 @@ int main(void)
         }
 
         keyboard_task();
+        Report_Task();
 
 #if !defined(INTERRUPT_CONTROL_ENDPOINT)
         USB_USBTask();
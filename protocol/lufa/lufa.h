@@ -43,6 +43,7 @@
 #include <avr/wdt.h>
 #include <avr/power.h>
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 #include <stdbool.h>
 #include <string.h>
 #include <LUFA/Version.h>
@@ -60,6 +61,25 @@ extern host_driver_t lufa_driver;
 }
 #endif
 
+/* report queues, power of two */
+#ifndef KEYBOARD_QUEUE_SIZE
+#define KEYBOARD_QUEUE_SIZE 8
+#endif
+#ifndef MOUSE_QUEUE_SIZE
+#define MOUSE_QUEUE_SIZE    4
+#endif
+#ifndef EXTRAKEY_QUEUE_SIZE
+#define EXTRAKEY_QUEUE_SIZE 4
+#endif
+
+/* peak occupancy of keyboard queue and count of intermediate reports replaced
+ * on its overflow */
+extern uint8_t keyboard_queue_peak;
+extern uint16_t keyboard_queue_merged;
+/* count of keyboard and extrakey reports discarded when queue is full or host
+ * doesn't take them in time */
+extern uint16_t report_queue_dropped;
+
 /* extra report structure */
 typedef struct {
     uint8_t  report_id;
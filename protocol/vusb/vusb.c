@@ -24,16 +24,43 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "host_driver.h"
 #include "vusb.h"
+#include "action_util.h"
 
 
 static uint8_t vusb_keyboard_leds = 0;
 static uint8_t vusb_idle_rate = 0;
 
-/* Keyboard report send buffer */
+/* Keyboard report send buffer
+ *
+ * Report queued is replaced with new one when it is only an intermediate
+ * state, that is, nothing changed in it is changed again by new one.
+ */
+#ifndef KBUF_SIZE
 #define KBUF_SIZE 16
+#endif
+#if (KBUF_SIZE & (KBUF_SIZE - 1))
+#   error "KBUF_SIZE must be power of two"
+#endif
+#define KBUF_MASK (KBUF_SIZE - 1)
 static report_keyboard_t kbuf[KBUF_SIZE];
 static uint8_t kbuf_head = 0;
 static uint8_t kbuf_tail = 0;
+static report_keyboard_t kbuf_sent = {};
+
+uint8_t vusb_kbuf_peak = 0;
+uint16_t vusb_kbuf_coalesced = 0;
+uint16_t vusb_kbuf_dropped = 0;
+
+uint8_t vusb_kbuf_used(void)
+{
+    return (kbuf_head - kbuf_tail) & KBUF_MASK;
+}
+
+/* macro player waits while buffer can't take reports of a macro command */
+bool host_keyboard_ready(void)
+{
+    return (KBUF_SIZE - 1 - vusb_kbuf_used()) >= 4;
+}
 
 
 /* transfer keyboard report from buffer */
@@ -42,10 +69,11 @@ void vusb_transfer_keyboard(void)
     if (usbInterruptIsReady()) {
         if (kbuf_head != kbuf_tail) {
             usbSetInterrupt((void *)&kbuf[kbuf_tail], sizeof(report_keyboard_t));
-            kbuf_tail = (kbuf_tail + 1) % KBUF_SIZE;
+            kbuf_sent = kbuf[kbuf_tail];
+            kbuf_tail = (kbuf_tail + 1) & KBUF_MASK;
             if (debug_keyboard) {
                 print("V-USB: kbuf["); pdec(kbuf_tail); print("->"); pdec(kbuf_head); print("](");
-                phex((kbuf_head < kbuf_tail) ? (KBUF_SIZE - kbuf_tail + kbuf_head) : (kbuf_head - kbuf_tail));
+                phex(vusb_kbuf_used());
                 print(")\n");
             }
         }
@@ -81,16 +109,26 @@ static uint8_t keyboard_leds(void) {
 
 static void send_keyboard(report_keyboard_t *report)
 {
-    uint8_t next = (kbuf_head + 1) % KBUF_SIZE;
+    if (kbuf_head != kbuf_tail) {
+        uint8_t last = (kbuf_head - 1) & KBUF_MASK;
+        report_keyboard_t *prev = (last == kbuf_tail) ? &kbuf_sent : &kbuf[(last - 1) & KBUF_MASK];
+        if (!keyboard_report_edge_lost(prev, &kbuf[last], report)) {
+            kbuf[last] = *report;
+            vusb_kbuf_coalesced++;
+            vusb_transfer_keyboard();
+            return;
+        }
+    }
+
+    uint8_t next = (kbuf_head + 1) & KBUF_MASK;
     if (next != kbuf_tail) {
         kbuf[kbuf_head] = *report;
         kbuf_head = next;
+        if (vusb_kbuf_used() > vusb_kbuf_peak) vusb_kbuf_peak = vusb_kbuf_used();
     } else {
+        vusb_kbuf_dropped++;
         debug("kbuf: full\n");
     }
-
-    // NOTE: send key strokes of Macro
-    usbPoll();
     vusb_transfer_keyboard();
 }
 
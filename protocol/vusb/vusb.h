@@ -18,10 +18,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef VUSB_H
 #define VUSB_H
 
+#include <stdint.h>
 #include "host_driver.h"
 
 
 host_driver_t *vusb_driver(void);
 void vusb_transfer_keyboard(void);
 
+/* keyboard report buffer: used, peak, replaced and dropped reports */
+uint8_t vusb_kbuf_used(void);
+extern uint8_t vusb_kbuf_peak;
+extern uint16_t vusb_kbuf_coalesced;
+extern uint16_t vusb_kbuf_dropped;
+
 #endif